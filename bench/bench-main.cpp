@@ -0,0 +1,51 @@
+#include "bench.h"
+
+#include <cstring>
+
+OutputFormat gOutputFormat = OutputFormat::TABLE;
+int gFailures = 0;
+
+// Usage: triqui_bench [--format table|csv|json]
+//
+// csv and json (one object per line) are meant to be saved and compared between versions.
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            const char *format = argv[++i];
+            if (std::strcmp(format, "table") == 0)
+            {
+                gOutputFormat = OutputFormat::TABLE;
+            }
+            else if (std::strcmp(format, "csv") == 0)
+            {
+                gOutputFormat = OutputFormat::CSV;
+            }
+            else if (std::strcmp(format, "json") == 0)
+            {
+                gOutputFormat = OutputFormat::JSON;
+            }
+            else
+            {
+                std::fprintf(stderr, "unknown format %s\n", format);
+                return 1;
+            }
+        }
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--format table|csv|json]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    PrintHeader();
+
+    RunComponentArrayBenchmarks();
+    RunEcsBenchmarks();
+    RunStorageBenchmarks();
+    RunGameBenchmarks();
+
+    return gFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Keeps the optimizer from discarding a value computed inside a benchmark loop.
+template <typename T>
+inline void DoNotOptimize(T const &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * @brief Timings of one benchmark over its repetitions, in nanoseconds per run of the body.
+ */
+struct Sample
+{
+    double min = 0.0;
+    double median = 0.0;
+    double mean = 0.0;
+    // Median absolute deviation from the median, a spread that a few outliers do not inflate
+    double mad = 0.0;
+    int repetitions = 0;
+};
+
+// Median of values sorted in ascending order
+inline double SortedMedian(const std::vector<double> &sorted)
+{
+    std::size_t middle = sorted.size() / 2;
+    return sorted.size() % 2 == 1 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2.0;
+}
+
+inline Sample Summarize(std::vector<double> times)
+{
+    std::sort(times.begin(), times.end());
+
+    Sample sample;
+    sample.repetitions = int(times.size());
+    sample.min = times.front();
+    sample.median = SortedMedian(times);
+
+    for (double time : times)
+    {
+        sample.mean += time;
+    }
+    sample.mean /= times.size();
+
+    std::vector<double> deviations;
+    deviations.reserve(times.size());
+    for (double time : times)
+    {
+        deviations.push_back(std::abs(time - sample.median));
+    }
+    std::sort(deviations.begin(), deviations.end());
+    sample.mad = SortedMedian(deviations);
+
+    return sample;
+}
+
+/**
+ * @brief Runs setup, untimed, then times the body, `repetitions` times after one warm-up run.
+ *
+ * Results are reported by their median, which a few runs disturbed by the scheduler do not
+ * move. The minimum and the spread are kept to tell a real change from noise.
+ */
+template <typename Setup, typename Body>
+Sample Measure(int repetitions, Setup &&setup, Body &&body)
+{
+    std::vector<double> times;
+    times.reserve(repetitions);
+
+    for (int i = -1; i < repetitions; ++i)
+    {
+        setup();
+
+        auto start = std::chrono::steady_clock::now();
+        body();
+        auto end = std::chrono::steady_clock::now();
+
+        // Run -1 warms the caches and the allocator up
+        if (i >= 0)
+        {
+            times.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+        }
+    }
+
+    return Summarize(times);
+}
+
+template <typename Body>
+Sample Measure(int repetitions, Body &&body)
+{
+    return Measure(repetitions, [] {}, body);
+}
+
+// Repetitions for a benchmark over `count` entities, fewer for the big ones that take long
+inline int RepetitionsFor(std::size_t count)
+{
+    return count >= 1000000 ? 7 : count >= 100000 ? 15
+                                                  : 31;
+}
+
+enum class OutputFormat
+{
+    TABLE,
+    CSV,
+    // One JSON object per line
+    JSON
+};
+
+extern OutputFormat gOutputFormat;
+
+inline void PrintHeader()
+{
+    switch (gOutputFormat)
+    {
+    case OutputFormat::TABLE:
+        std::printf("%-44s %9s %15s %15s %8s %13s\n", "benchmark", "entities", "median", "min", "mad", "throughput");
+        break;
+    case OutputFormat::CSV:
+        std::printf("benchmark,entities,operations,repetitions,median_ns_per_op,min_ns_per_op,mean_ns_per_op,mad_ns_per_op,mad_percent\n");
+        break;
+    case OutputFormat::JSON:
+        break;
+    }
+}
+
+/**
+ * @brief Prints one result, `operations` is how many operations one run of the body did.
+ */
+inline void PrintResult(const char *name, std::size_t count, std::size_t operations, const Sample &sample)
+{
+    double perOp = 1.0 / operations;
+    // The spread relative to the median, comparable between benchmarks of any speed
+    double madPercent = sample.median > 0.0 ? 100.0 * sample.mad / sample.median : 0.0;
+
+    switch (gOutputFormat)
+    {
+    case OutputFormat::TABLE:
+        std::printf("%-44s %9zu %12.2f ns/op %12.2f ns/op %7.1f%% %8.1f Mop/s\n", name, count, sample.median * perOp, sample.min * perOp,
+                    madPercent, operations * 1e3 / sample.median);
+        break;
+    case OutputFormat::CSV:
+        std::printf("\"%s\",%zu,%zu,%d,%.3f,%.3f,%.3f,%.3f,%.2f\n", name, count, operations, sample.repetitions, sample.median * perOp,
+                    sample.min * perOp, sample.mean * perOp, sample.mad * perOp, madPercent);
+        break;
+    case OutputFormat::JSON:
+        std::printf("{\"benchmark\":\"%s\",\"entities\":%zu,\"operations\":%zu,\"repetitions\":%d,\"median_ns_per_op\":%.3f,"
+                    "\"min_ns_per_op\":%.3f,\"mean_ns_per_op\":%.3f,\"mad_ns_per_op\":%.3f,\"mad_percent\":%.2f}\n",
+                    name, count, operations, sample.repetitions, sample.median * perOp, sample.min * perOp, sample.mean * perOp,
+                    sample.mad * perOp, madPercent);
+        break;
+    }
+    std::fflush(stdout);
+}
+
+// Checks that failed while benchmarking, triqui_bench exits with 1 when there are any
+extern int gFailures;
+
+/**
+ * @brief Reports a failed check, for benchmarks that also guard a property such as bounded memory.
+ */
+inline void ReportFailure(const char *name, const char *message)
+{
+    std::fprintf(stderr, "FAILED %s: %s\n", name, message);
+    gFailures++;
+}
+
+// Benchmark groups, one per source file
+void RunComponentArrayBenchmarks();
+void RunEcsBenchmarks();
+void RunStorageBenchmarks();
+void RunGameBenchmarks();
@@ -0,0 +1,141 @@
+// Compares the sparse-set ComponentArray against the previous unordered_map based one:
+// GetData in random (lookup) and ID (iterate) order, InsertData and RemoveData.
+
+#include "bench.h"
+#include "entity-component-system.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Copy of the ComponentArray this repo used before the sparse-set layout, kept as a baseline.
+template <typename T>
+class LegacyComponentArray
+{
+private:
+    std::vector<T> mComponentArray;
+    std::unordered_map<Entity, std::size_t> mEntityToIndexMap;
+    std::unordered_map<std::size_t, Entity> mIndexToEntityMap;
+    std::size_t mSize{};
+
+public:
+    void InsertData(Entity entity, T component)
+    {
+        std::size_t newIndex = mSize;
+        mEntityToIndexMap[entity] = newIndex;
+        mIndexToEntityMap[newIndex] = entity;
+        mComponentArray.push_back(component);
+        ++mSize;
+    }
+
+    void RemoveData(Entity entity)
+    {
+        assert(mEntityToIndexMap.find(entity) != mEntityToIndexMap.end() && "Removing non-existent component.");
+
+        // Move the last element into the removed one's slot
+        std::size_t indexOfRemovedEntity = mEntityToIndexMap[entity];
+        std::size_t indexOfLastElement = mSize - 1;
+        mComponentArray[indexOfRemovedEntity] = mComponentArray[indexOfLastElement];
+        mComponentArray.pop_back();
+
+        Entity entityOfLastElement = mIndexToEntityMap[indexOfLastElement];
+        mEntityToIndexMap[entityOfLastElement] = indexOfRemovedEntity;
+        mIndexToEntityMap[indexOfRemovedEntity] = entityOfLastElement;
+
+        mEntityToIndexMap.erase(entity);
+        mIndexToEntityMap.erase(indexOfLastElement);
+        --mSize;
+    }
+
+    T &GetData(Entity entity)
+    {
+        assert(mEntityToIndexMap.find(entity) != mEntityToIndexMap.end() && "Retrieving non-existent component.");
+        std::size_t indexOfEntity = mEntityToIndexMap[entity];
+
+        return mComponentArray[indexOfEntity];
+    }
+};
+
+struct Position
+{
+    float x;
+    float y;
+};
+
+template <typename Array>
+void Run(const char *label, std::size_t count)
+{
+    auto array = std::make_unique<Array>();
+
+    // Systems iterate entities in ID order, lookups in the wild arrive in no particular order.
+    std::vector<Entity> ordered(count);
+    std::iota(ordered.begin(), ordered.end(), 0);
+    std::vector<Entity> shuffled = ordered;
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937{42});
+
+    for (Entity entity : shuffled)
+    {
+        array->InsertData(entity, Position{float(entity), 0.0f});
+    }
+
+    int repetitions = RepetitionsFor(count);
+    std::string name = label;
+
+    Sample lookup = Measure(repetitions, [&]
+                                {
+        float sum = 0.0f;
+        for (Entity entity : shuffled)
+        {
+            sum += array->GetData(entity).x;
+        }
+        DoNotOptimize(sum); });
+    PrintResult((name + " lookup").c_str(), count, count, lookup);
+
+    Sample iterate = Measure(repetitions, [&]
+                                 {
+        for (Entity entity : ordered)
+        {
+            array->GetData(entity).y += 1.0f;
+        }
+        DoNotOptimize(array->GetData(0)); });
+    PrintResult((name + " iterate").c_str(), count, count, iterate);
+
+    Sample insert = Measure(
+        repetitions, [&]
+        { array = std::make_unique<Array>(); },
+        [&]
+        {
+            for (Entity entity : shuffled)
+            {
+                array->InsertData(entity, Position{float(entity), 0.0f});
+            } });
+    PrintResult((name + " insert").c_str(), count, count, insert);
+
+    Sample remove = Measure(
+        repetitions, [&]
+        {
+            array = std::make_unique<Array>();
+            for (Entity entity : ordered)
+            {
+                array->InsertData(entity, Position{float(entity), 0.0f});
+            } },
+        [&]
+        {
+            for (Entity entity : shuffled)
+            {
+                array->RemoveData(entity);
+            } });
+    PrintResult((name + " remove").c_str(), count, count, remove);
+}
+
+void RunComponentArrayBenchmarks()
+{
+    for (std::size_t count : {std::size_t{1000}, std::size_t{100000}, std::size_t{1000000}})
+    {
+        Run<LegacyComponentArray<Position>>("ComponentArray (unordered_map)", count);
+        Run<ComponentArray<Position>>("ComponentArray (sparse set)", count);
+    }
+}
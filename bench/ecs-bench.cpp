@@ -0,0 +1,153 @@
+// Entity bookkeeping: EntityManager, SystemManager membership updates and System::mEntities.
+
+#include "bench.h"
+#include "entity-component-system.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    template <int N>
+    class BenchSystem : public System
+    {
+    };
+
+    constexpr ComponentType SYSTEM_COUNT = 8;
+
+    // System N needs components N and N + 1, so every component is in the signature of two systems
+    template <int N>
+    std::shared_ptr<System> RegisterBenchSystem(SystemManager &systemManager)
+    {
+        auto system = systemManager.RegisterSystem<BenchSystem<N>>();
+
+        Signature signature;
+        signature.set(N);
+        signature.set((N + 1) % SYSTEM_COUNT);
+        systemManager.SetSignature<BenchSystem<N>>(signature);
+
+        return system;
+    }
+
+    template <int... Ns>
+    std::vector<std::shared_ptr<System>> RegisterBenchSystems(SystemManager &systemManager, std::integer_sequence<int, Ns...>)
+    {
+        return {RegisterBenchSystem<Ns>(systemManager)...};
+    }
+
+    void RunEntityManager(std::size_t count)
+    {
+        int repetitions = RepetitionsFor(count);
+        std::unique_ptr<EntityManager> entityManager;
+
+        Sample create = Measure(
+            repetitions, [&]
+            { entityManager = std::make_unique<EntityManager>(); },
+            [&]
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    DoNotOptimize(entityManager->CreateEntity());
+                } });
+        PrintResult("EntityManager CreateEntity", count, count, create);
+
+        Sample destroy = Measure(
+            repetitions, [&]
+            {
+                entityManager = std::make_unique<EntityManager>();
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    entityManager->CreateEntity();
+                } },
+            [&]
+            {
+                for (Entity entity = 0; entity < count; ++entity)
+                {
+                    entityManager->DestroyEntity(entity);
+                } });
+        PrintResult("EntityManager DestroyEntity", count, count, destroy);
+
+        // IDs handed out again from the free queue
+        Sample recycle = Measure(repetitions, [&]
+                                 {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                DoNotOptimize(entityManager->CreateEntity());
+            }
+            for (Entity entity = 0; entity < count; ++entity)
+            {
+                entityManager->DestroyEntity(entity);
+            } });
+        PrintResult("EntityManager recycle (create + destroy)", count, 2 * count, recycle);
+    }
+
+    void RunSystemManager(std::size_t count)
+    {
+        int repetitions = RepetitionsFor(count);
+
+        SystemManager systemManager;
+        auto systems = RegisterBenchSystems(systemManager, std::make_integer_sequence<int, SYSTEM_COUNT>{});
+
+        Signature full;
+        for (ComponentType component = 0; component < SYSTEM_COUNT; ++component)
+        {
+            full.set(component);
+        }
+        Signature partial = full;
+        partial.reset(0);
+
+        for (Entity entity = 0; entity < count; ++entity)
+        {
+            systemManager.EntitySignatureChanged(entity, full);
+        }
+
+        // Every run flips component 0 on all entities, which moves them in or out of two systems
+        bool hasComponent = true;
+        Sample changed = Measure(repetitions, [&]
+                                 {
+            hasComponent = !hasComponent;
+            Signature signature = hasComponent ? full : partial;
+            for (Entity entity = 0; entity < count; ++entity)
+            {
+                systemManager.EntitySignatureChanged(entity, signature, 0);
+            } });
+        PrintResult("SystemManager EntitySignatureChanged", count, count, changed);
+
+        Sample changedAll = Measure(repetitions, [&]
+                                    {
+            hasComponent = !hasComponent;
+            Signature signature = hasComponent ? full : partial;
+            for (Entity entity = 0; entity < count; ++entity)
+            {
+                systemManager.EntitySignatureChanged(entity, signature);
+            } });
+        PrintResult("SystemManager EntitySignatureChanged (all)", count, count, changedAll);
+
+        // Give every entity all the components again and walk one system's members
+        for (Entity entity = 0; entity < count; ++entity)
+        {
+            systemManager.EntitySignatureChanged(entity, full, 0);
+        }
+        const System &system = *systems.front();
+
+        Sample iterate = Measure(repetitions, [&]
+                                 {
+            std::uint64_t sum = 0;
+            for (Entity entity : system.mEntities)
+            {
+                sum += entity;
+            }
+            DoNotOptimize(sum); });
+        PrintResult("System::mEntities iterate", count, count, iterate);
+    }
+}
+
+void RunEcsBenchmarks()
+{
+    for (std::size_t count : {std::size_t{1000}, std::size_t{100000}, std::size_t{1000000}})
+    {
+        RunEntityManager(count);
+        RunSystemManager(count);
+    }
+}
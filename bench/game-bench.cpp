@@ -0,0 +1,239 @@
+// Win checking of the game rules, through GameSystem::Update over many games, checkpointing
+// those worlds with snapshots, and finding the cell under a click.
+
+#include "bench.h"
+#include "game.h"
+#include "thread-pool.h"
+
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    // Forwards to new/delete and keeps count of the bytes handed out and not yet returned
+    class CountingResource : public std::pmr::memory_resource
+    {
+    public:
+        std::size_t mBytes = 0;
+
+    private:
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+            mBytes += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void *pointer, std::size_t bytes, std::size_t alignment) override
+        {
+            mBytes -= bytes;
+            std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    // Plays random moves until `moves` are on the board and nobody has won, retrying from an
+    // empty board when a game ends early. lastMove is left on the newest mark.
+    GameStatus MidGame(const BoardRules &rules, int moves, std::uint64_t &random)
+    {
+        for (;;)
+        {
+            GameStatus gameStatus = NewGameStatus(rules);
+            int cell = -1;
+            for (int player = 0; gameStatus.status == GameStatusEnum::PLAYING && gameStatus.moveCount < moves; player ^= 1)
+            {
+                random ^= random << 13;
+                random ^= random >> 7;
+                random ^= random << 17;
+                int empty = EmptyCellCount(gameStatus);
+                cell = NthEmptyCell(gameStatus, int(random % std::uint64_t(empty)));
+                ApplyMove(gameStatus, cell, player);
+                EvaluateLastMove(gameStatus);
+            }
+
+            if (gameStatus.status == GameStatusEnum::PLAYING)
+            {
+                gameStatus.lastMove = cell;
+                return gameStatus;
+            }
+        }
+    }
+
+    // Every `stride`-th game gets a new move before each update, the others stay idle
+    void Run(ThreadPool &pool, const BoardRules &rules, int moves, std::size_t count, std::size_t stride = 1)
+    {
+        std::string name = "GameSystem Update " + std::to_string(rules.width) + "," + std::to_string(rules.height) + "," +
+                           std::to_string(rules.winLength);
+        if (stride > 1)
+        {
+            name += ", 1 in " + std::to_string(stride) + " active";
+        }
+
+        gCoordinator.Init();
+        std::shared_ptr<InputSystem> inputSystem;
+        std::shared_ptr<GameSystem> gameSystem;
+        RegisterGame(inputSystem, gameSystem);
+
+        std::uint64_t random = 0x9E3779B97F4A7C15ull;
+        std::vector<std::pair<Entity, int>> lastMoves;
+        lastMoves.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            Entity game = CreateGame(rules);
+            GameStatus &gameStatus = gCoordinator.GetComponent<GameStatus>(game);
+            gameStatus = MidGame(rules, moves, random);
+            // Evaluating clears lastMove, it is set again before every run
+            lastMoves.emplace_back(game, gameStatus.lastMove);
+        }
+
+        Sample update = Measure(
+            RepetitionsFor(count), [&]
+            {
+                for (std::size_t i = 0; i < lastMoves.size(); i += stride)
+                {
+                    gCoordinator.GetComponent<GameStatus>(lastMoves[i].first).lastMove = lastMoves[i].second;
+                } },
+            [&]
+            { gameSystem->Update(pool); });
+        PrintResult(name.c_str(), count, count, update);
+    }
+
+    // Building a world of `count` games from scratch against saving and restoring it
+    void RunSnapshot(const BoardRules &rules, std::size_t count)
+    {
+        std::shared_ptr<InputSystem> inputSystem;
+        std::shared_ptr<GameSystem> gameSystem;
+        auto build = [&](std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+        {
+            gCoordinator.Init(0, upstream);
+            RegisterGame(inputSystem, gameSystem);
+            CreateCells(rules);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                CreateGame(rules);
+            }
+        };
+
+        int repetitions = RepetitionsFor(count);
+        Sample rebuild = Measure(repetitions, build);
+        PrintResult("World rebuild (CreateCells + CreateGame)", count, count, rebuild);
+
+        // Releasing a built world, Init drops it into the world memory's arena in one go
+        Sample teardown = Measure(repetitions, build, [&]
+                                  { gCoordinator.Init(); });
+        PrintResult("World teardown (Init)", count, count, teardown);
+
+        build();
+        std::vector<std::byte> snapshot;
+        Sample save = Measure(repetitions, [&]
+                              { gCoordinator.SaveSnapshot(snapshot); });
+        PrintResult("World SaveSnapshot", count, count, save);
+
+        Sample load = Measure(repetitions, [&]
+                              { DoNotOptimize(gCoordinator.LoadSnapshot(snapshot)); });
+        PrintResult("World LoadSnapshot", count, count, load);
+
+        // Loading over and over has to reuse the world's storage, not grow its arena until Init
+        CountingResource upstream;
+        build(&upstream);
+        gCoordinator.SaveSnapshot(snapshot);
+        gCoordinator.LoadSnapshot(snapshot);
+        std::size_t loaded = upstream.mBytes;
+        for (int i = 0; i < 100; ++i)
+        {
+            gCoordinator.LoadSnapshot(snapshot);
+        }
+        if (upstream.mBytes > loaded)
+        {
+            ReportFailure("World LoadSnapshot", "world memory grew with every load");
+        }
+
+        // Half a snapshot is turned down before the world is touched
+        std::vector<std::byte> saved;
+        gCoordinator.SaveSnapshot(saved);
+        if (gCoordinator.LoadSnapshot(snapshot.data(), snapshot.size() / 2))
+        {
+            ReportFailure("World LoadSnapshot", "a truncated snapshot was loaded");
+        }
+        gCoordinator.SaveSnapshot(snapshot);
+        if (snapshot != saved)
+        {
+            ReportFailure("World LoadSnapshot", "a truncated snapshot changed the world");
+        }
+        // The upstream has to outlive the world that takes memory from it
+        gCoordinator.Init();
+    }
+
+    // Finding the cell under each of `clicks` points by testing every cell against the layout
+    void RunHitTest(const BoardRules &rules, std::size_t clicks)
+    {
+        std::string name = "Cell hit test " + std::to_string(rules.width) + "," + std::to_string(rules.height) + "," +
+                           std::to_string(rules.winLength);
+
+        gCoordinator.Init();
+        std::shared_ptr<InputSystem> inputSystem;
+        std::shared_ptr<GameSystem> gameSystem;
+        RegisterGame(inputSystem, gameSystem);
+        CreateCells(rules);
+
+        std::uint64_t random = 0x9E3779B97F4A7C15ull;
+        std::vector<std::pair<float, float>> points;
+        for (std::size_t i = 0; i < clicks; ++i)
+        {
+            random ^= random << 13;
+            random ^= random >> 7;
+            random ^= random << 17;
+            points.emplace_back(float(random % 600), float((random >> 32) % 600));
+        }
+
+        std::size_t cells = std::size_t(rules.width * rules.height);
+        Sample scan = Measure(RepetitionsFor(cells), [&]
+                              {
+            for (const auto &[x, y] : points)
+            {
+                BoardPosition found{};
+                gCoordinator.View<GridCell, BoardPosition>().Each([&](Entity, GridCell &cell, BoardPosition &position)
+                                                                  {
+                    if (x >= cell.rect.x && x < cell.rect.x + cell.rect.width && y >= cell.rect.y && y < cell.rect.y + cell.rect.height)
+                    {
+                        found = position;
+                    } });
+                DoNotOptimize(found);
+            } });
+        PrintResult((name + " (scan)").c_str(), cells, clicks, scan);
+
+        BoardLayout layout;
+        layout.Build(rules);
+        Sample indexed = Measure(RepetitionsFor(cells), [&]
+                                 {
+            for (const auto &[x, y] : points)
+            {
+                BoardPosition found{};
+                DoNotOptimize(layout.CellAt(x, y, found));
+                DoNotOptimize(found);
+            } });
+        PrintResult((name + " (BoardLayout)").c_str(), cells, clicks, indexed);
+    }
+}
+
+void RunGameBenchmarks()
+{
+    ThreadPool pool;
+
+    RunHitTest(CLASSIC_RULES, 10000);
+    RunHitTest(BoardRules{MAX_BOARD_SIDE, MAX_BOARD_SIDE, 5}, 10000);
+
+    for (std::size_t count : {std::size_t{1000}, std::size_t{10000}, std::size_t{100000}})
+    {
+        Run(pool, CLASSIC_RULES, 4, count);
+        Run(pool, BoardRules{15, 15, 5}, 40, count);
+        Run(pool, BoardRules{15, 15, 5}, 40, count, 100);
+        RunSnapshot(BoardRules{15, 15, 5}, count);
+    }
+}
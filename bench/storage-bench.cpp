@@ -0,0 +1,119 @@
+// Compares the per-type pool storage against archetype chunks through the Coordinator.
+
+#include "bench.h"
+#include "entity-component-system.h"
+
+#include <string>
+
+namespace
+{
+    struct Cell
+    {
+        char value;
+        float rect[4];
+    };
+
+    struct Position
+    {
+        int row;
+        int col;
+    };
+
+    struct Tag
+    {
+        int value;
+    };
+
+    class CellSystem : public System
+    {
+    };
+
+    template <typename Storage>
+    std::shared_ptr<CellSystem> Spawn(BasicCoordinator<Storage> &coordinator, std::size_t count)
+    {
+        coordinator.Init();
+        coordinator.template RegisterComponent<Cell>();
+        coordinator.template RegisterComponent<Position>();
+        coordinator.template RegisterComponent<Tag>();
+
+        auto system = coordinator.template RegisterSystem<CellSystem>();
+        Signature signature;
+        signature.set(coordinator.template GetComponentType<Cell>());
+        signature.set(coordinator.template GetComponentType<Position>());
+        coordinator.template SetSystemSignature<CellSystem>(signature);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            Entity entity = coordinator.CreateEntity();
+            coordinator.AddComponent(entity, Position{int(i / 1000), int(i % 1000)});
+            coordinator.AddComponent(entity, Cell{'-', {0.0f, 0.0f, 1.0f, 1.0f}});
+            // A third of the entities get another component, so the pools are not in lockstep
+            if (i % 3 == 0)
+            {
+                coordinator.AddComponent(entity, Tag{int(i)});
+            }
+        }
+
+        return system;
+    }
+
+    template <typename Storage>
+    void Run(const char *label, std::size_t count)
+    {
+        std::string name = label;
+        int repetitions = RepetitionsFor(count);
+
+        Sample spawn = Measure(repetitions, [&]
+                                   {
+            BasicCoordinator<Storage> coordinator;
+            Spawn(coordinator, count); });
+        PrintResult((name + " spawn").c_str(), count, count, spawn);
+
+        Sample bulkSpawn = Measure(repetitions, [&]
+                                       {
+            BasicCoordinator<Storage> coordinator;
+            Spawn(coordinator, 0);
+            auto entities = coordinator.CreateEntities(count, Position{0, 0}, Cell{'-', {0.0f, 0.0f, 1.0f, 1.0f}});
+            DoNotOptimize(entities.data()); });
+        PrintResult((name + " bulk spawn").c_str(), count, count, bulkSpawn);
+
+        BasicCoordinator<Storage> coordinator;
+        auto system = Spawn(coordinator, count);
+
+        // The render loop shape: read two components of every entity in the system
+        Sample iterate = Measure(repetitions, [&]
+                                     {
+            float sum = 0.0f;
+            for (Entity entity : system->mEntities)
+            {
+                auto &cell = coordinator.template GetComponent<Cell>(entity);
+                auto &position = coordinator.template GetComponent<Position>(entity);
+                sum += cell.rect[2] * position.row;
+            }
+            DoNotOptimize(sum); });
+        PrintResult((name + " iterate 2").c_str(), count, count, iterate);
+
+        Sample view = Measure(repetitions, [&]
+                                  {
+            float sum = 0.0f;
+            coordinator.template View<Cell, Position>().Each([&](Entity, Cell &cell, Position &position)
+                                                             { sum += cell.rect[2] * position.row; });
+            DoNotOptimize(sum); });
+        PrintResult((name + " view 2").c_str(), count, count, view);
+
+        static ThreadPool pool;
+        Sample parallel = Measure(repetitions, [&]
+                                      { coordinator.template View<Cell, Position>().ParallelEach(pool, [](Entity, Cell &cell, Position &position)
+                                                                                                 { cell.rect[0] = cell.rect[2] * position.row; }); });
+        PrintResult((name + " parallel view 2").c_str(), count, count, parallel);
+    }
+}
+
+void RunStorageBenchmarks()
+{
+    for (std::size_t count : {std::size_t{1000}, std::size_t{100000}, std::size_t{1000000}})
+    {
+        Run<ComponentManager>("Coordinator (pools)", count);
+        Run<ArchetypeManager>("Coordinator (archetypes)", count);
+    }
+}
@@ -1,10 +1,28 @@
 #pragma once
 
 #include <cstdint>
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <bitset>
-#include <queue>
+#include <deque>
+#include <type_traits>
 #include <cassert>
-#include <set>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "profiler.h"
+#include "snapshot.h"
+#include "thread-pool.h"
 
 #ifdef _WIN32
 #define ECS_EXPORT __declspec(dllexport)
@@ -13,373 +31,3425 @@
 #endif
 
 ECS_EXPORT using Entity = std::uint32_t;
-ECS_EXPORT const Entity MAX_ENTITIES = 11;
+// Largest number of entities that can exist at once, the last ID is kept free as a sentinel.
+// Real IDs stay below bit 31, which marks the provisional entities of a CommandBuffer.
+ECS_EXPORT const Entity MAX_ENTITIES = (Entity{1} << 31) - 1;
 
 ECS_EXPORT using ComponentType = std::uint8_t;
 ECS_EXPORT const ComponentType MAX_COMPONENTS = 32;
 
 ECS_EXPORT using Signature = std::bitset<MAX_COMPONENTS>;
 
+/**
+ * @brief Where a world's storage comes from: a bump arena with size-class pools on top.
+ *
+ * The pools serve what is allocated and freed per entity (pages, members, chunks, the
+ * growing arrays) and recycle freed blocks by size, they take their memory from the arena,
+ * which only ever bumps a pointer. Reset drops everything at once. The arena's buffers are
+ * kept for the next world instead of going back upstream, so worlds of a similar size are
+ * built again without touching the upstream resource.
+ *
+ * Not thread-safe, it is only allocated from by structural changes, which run on one thread.
+ */
+class ECS_EXPORT WorldMemory
+{
+private:
+    /**
+     * @brief Upstream of the arena, keeps the buffers the arena releases and hands them out again.
+     *
+     * The arena asks for the same growing sizes every time it fills up, so a world that
+     * grows like the previous one gets all of its buffers back from here.
+     */
+    class BufferCache : public std::pmr::memory_resource
+    {
+    private:
+        struct Buffer
+        {
+            void *pointer;
+            std::size_t bytes;
+            std::size_t alignment;
+        };
+
+        std::pmr::memory_resource *mUpstream = std::pmr::new_delete_resource();
+        std::vector<Buffer> mFree{};
+
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+            for (std::size_t i = 0; i < mFree.size(); ++i)
+            {
+                if (mFree[i].bytes == bytes && mFree[i].alignment == alignment)
+                {
+                    void *pointer = mFree[i].pointer;
+                    mFree[i] = mFree.back();
+                    mFree.pop_back();
+                    return pointer;
+                }
+            }
+
+            return mUpstream->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void *pointer, std::size_t bytes, std::size_t alignment) override
+        {
+            mFree.push_back(Buffer{pointer, bytes, alignment});
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+
+    public:
+        BufferCache() = default;
+        BufferCache(const BufferCache &) = delete;
+        BufferCache &operator=(const BufferCache &) = delete;
+
+        ~BufferCache()
+        {
+            Clear();
+        }
+
+        // Gives the kept buffers back upstream
+        void Clear()
+        {
+            for (const Buffer &buffer : mFree)
+            {
+                mUpstream->deallocate(buffer.pointer, buffer.bytes, buffer.alignment);
+            }
+            mFree.clear();
+        }
+
+        void SetUpstream(std::pmr::memory_resource *upstream)
+        {
+            if (upstream != mUpstream)
+            {
+                Clear();
+                mUpstream = upstream;
+            }
+        }
+    };
+
+    // Blocks up to an archetype chunk and a bit more are pooled, larger ones come straight from the arena
+    static constexpr std::size_t LARGEST_POOLED_BLOCK = 32 * 1024;
+
+    static std::pmr::pool_options PoolOptions()
+    {
+        std::pmr::pool_options options;
+        options.largest_required_pool_block = LARGEST_POOLED_BLOCK;
+        return options;
+    }
+
+    // Declared in the order each one needs the previous one
+    BufferCache mBuffers;
+    std::pmr::monotonic_buffer_resource mArena{&mBuffers};
+    std::pmr::unsynchronized_pool_resource mPools{PoolOptions(), &mArena};
+
+public:
+    WorldMemory() = default;
+    WorldMemory(const WorldMemory &) = delete;
+    WorldMemory &operator=(const WorldMemory &) = delete;
+
+    /**
+     * @brief Releases everything allocated so far in one go.
+     *
+     * Everything allocated from Resource() must be destroyed first, memory is not handed
+     * back to the objects that still point into it.
+     *
+     * @param upstream Resource the arena takes its memory from after the reset.
+     */
+    void Reset(std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+    {
+        mPools.release();
+        mArena.release();
+        mBuffers.SetUpstream(upstream);
+    }
+
+    std::pmr::memory_resource *Resource()
+    {
+        return &mPools;
+    }
+};
+
+/**
+ * @brief Deleter for objects made with MakeResourcePtr, gives their memory back to the resource.
+ */
+struct ECS_EXPORT ResourceDeleter
+{
+    std::pmr::memory_resource *resource = nullptr;
+    // Of the object that was made, which may be a derived class of the pointer's type
+    std::size_t size = 0;
+    std::size_t alignment = 0;
+
+    template <typename T>
+    void operator()(T *object) const
+    {
+        object->~T();
+        resource->deallocate(object, size, alignment);
+    }
+};
+
+template <typename T>
+using ResourcePtr = std::unique_ptr<T, ResourceDeleter>;
+
+/**
+ * @brief Like std::make_unique, with the object allocated from the given memory resource.
+ */
+template <typename T, typename... Args>
+ResourcePtr<T> MakeResourcePtr(std::pmr::memory_resource *resource, Args &&...args)
+{
+    void *memory = resource->allocate(sizeof(T), alignof(T));
+    return ResourcePtr<T>(new (memory) T(std::forward<Args>(args)...), ResourceDeleter{resource, sizeof(T), alignof(T)});
+}
+
+/**
+ * @brief Array split into fixed-size pages that are allocated on demand.
+ *
+ * Growing never moves existing elements, so references into the array stay valid
+ * while it grows. Pages are only allocated for the index ranges that are used.
+ *
+ * @tparam T The element type, it must be default constructible.
+ * @tparam PageSize Number of elements per page, must be a power of two.
+ */
+template <typename T, std::size_t PageSize>
+class ECS_EXPORT PagedArray
+{
+    static_assert((PageSize & (PageSize - 1)) == 0, "PageSize must be a power of two.");
+
+private:
+    std::pmr::memory_resource *mResource;
+    // Null for pages that are not allocated
+    std::pmr::vector<T *> mPages;
+
+public:
+    explicit PagedArray(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : mResource(resource), mPages(resource)
+    {
+    }
+
+    ~PagedArray()
+    {
+        for (T *page : mPages)
+        {
+            if (page != nullptr)
+            {
+                std::destroy_n(page, PageSize);
+                mResource->deallocate(page, PageSize * sizeof(T), alignof(T));
+            }
+        }
+    }
+
+    PagedArray(PagedArray &&other) noexcept
+        : mResource(other.mResource), mPages(std::move(other.mPages))
+    {
+        other.mPages.clear();
+    }
+
+    PagedArray(const PagedArray &) = delete;
+    PagedArray &operator=(const PagedArray &) = delete;
+
+    static constexpr std::size_t PageOf(std::size_t index)
+    {
+        return index / PageSize;
+    }
+
+    bool HasPage(std::size_t page) const
+    {
+        return page < mPages.size() && mPages[page] != nullptr;
+    }
+
+    /**
+     * @brief Allocates the page holding the given index if it does not exist yet.
+     */
+    void EnsurePage(std::size_t page)
+    {
+        if (page >= mPages.size())
+        {
+            mPages.resize(page + 1);
+        }
+
+        if (mPages[page] == nullptr)
+        {
+            T *memory = static_cast<T *>(mResource->allocate(PageSize * sizeof(T), alignof(T)));
+            // Value-initialized like new T[PageSize](), so counters and versions start at zero
+            for (std::size_t i = 0; i < PageSize; ++i)
+            {
+                new (memory + i) T();
+            }
+            mPages[page] = memory;
+        }
+    }
+
+    /**
+     * @brief Allocates every page needed to hold indices [0, capacity).
+     */
+    void Reserve(std::size_t capacity)
+    {
+        for (std::size_t page = 0; page * PageSize < capacity; ++page)
+        {
+            EnsurePage(page);
+        }
+    }
+
+    std::size_t Capacity() const
+    {
+        return mPages.size() * PageSize;
+    }
+
+    T &operator[](std::size_t index)
+    {
+        assert(HasPage(PageOf(index)) && "Accessing an unallocated page.");
+
+        return mPages[index / PageSize][index % PageSize];
+    }
+
+    const T &operator[](std::size_t index) const
+    {
+        assert(HasPage(PageOf(index)) && "Accessing an unallocated page.");
+
+        return mPages[index / PageSize][index % PageSize];
+    }
+};
+
+/**
+ * @brief The component types of a world in the order they were registered.
+ *
+ * ComponentTypeOf numbers types by their first use anywhere in the process, including the
+ * Reads and Writes of systems, so one component can get another ComponentType in another run.
+ * The registration order only depends on the code that builds the world, so snapshots save
+ * components and signatures by registration index, together with each component's size and
+ * alignment to tell a world with other components apart.
+ */
+class ECS_EXPORT ComponentRegistry
+{
+private:
+    std::array<ComponentType, MAX_COMPONENTS> mTypes{};
+    std::array<std::uint32_t, MAX_COMPONENTS> mSizes{};
+    std::array<std::uint32_t, MAX_COMPONENTS> mAlignments{};
+    // Registration index of each ComponentType, only meaningful for registered types
+    std::array<std::uint32_t, MAX_COMPONENTS> mIndices{};
+    std::uint32_t mCount = 0;
+    // Whether every type was registered at the index equal to it, so signatures need no mapping
+    bool mIdentity = true;
+
+public:
+    static_assert(MAX_COMPONENTS <= 32, "Signatures no longer fit the snapshot format.");
+
+    void Add(ComponentType type, std::size_t size, std::size_t alignment)
+    {
+        assert(mCount < MAX_COMPONENTS && "Too many component types.");
+
+        mTypes[mCount] = type;
+        mSizes[mCount] = std::uint32_t(size);
+        mAlignments[mCount] = std::uint32_t(alignment);
+        mIndices[type] = mCount;
+        mIdentity = mIdentity && type == mCount;
+        ++mCount;
+    }
+
+    std::uint32_t Count() const
+    {
+        return mCount;
+    }
+
+    // Component type registered at the given index, valid for indices below Count()
+    ComponentType TypeAt(std::uint32_t index) const
+    {
+        return mTypes[index];
+    }
+
+    std::uint32_t IndexOf(ComponentType type) const
+    {
+        return mIndices[type];
+    }
+
+    std::uint32_t SizeAt(std::uint32_t index) const
+    {
+        return mSizes[index];
+    }
+
+    /**
+     * @brief The signature as saved in snapshots: one bit per registration index.
+     */
+    std::uint32_t SaveSignature(Signature signature) const
+    {
+        if (mIdentity)
+        {
+            return std::uint32_t(signature.to_ulong());
+        }
+
+        std::uint32_t bits = 0;
+        for (std::uint32_t index = 0; index < mCount; ++index)
+        {
+            bits |= std::uint32_t(signature.test(mTypes[index])) << index;
+        }
+
+        return bits;
+    }
+
+    /**
+     * @brief The inverse of SaveSignature, bits past Count() are dropped.
+     */
+    Signature LoadSignature(std::uint32_t bits) const
+    {
+        if (mIdentity)
+        {
+            return Signature(bits & ValidBits());
+        }
+
+        Signature signature;
+        for (std::uint32_t index = 0; index < mCount; ++index)
+        {
+            signature.set(mTypes[index], (bits >> index) & 1u);
+        }
+
+        return signature;
+    }
+
+    // Bits a saved signature may have set
+    std::uint32_t ValidBits() const
+    {
+        return mCount == 32 ? ~std::uint32_t{0} : (std::uint32_t{1} << mCount) - 1;
+    }
+
+    /**
+     * @brief Writes the count, then the size and alignment of every component in registration order.
+     */
+    void Save(SnapshotWriter &writer) const
+    {
+        writer.WriteValue(mCount);
+        writer.Write(mSizes.data(), mCount * sizeof(std::uint32_t));
+        writer.Write(mAlignments.data(), mCount * sizeof(std::uint32_t));
+    }
+
+    /**
+     * @brief Reads what Save wrote, and tells whether it describes the same components.
+     */
+    bool Matches(SnapshotReader &reader) const
+    {
+        if (reader.ReadValue<std::uint32_t>() != mCount)
+        {
+            return false;
+        }
+
+        const std::byte *sizes = reader.Read(mCount * sizeof(std::uint32_t));
+        const std::byte *alignments = reader.Read(mCount * sizeof(std::uint32_t));
+        return !reader.Failed() && (mCount == 0 || (std::memcmp(sizes, mSizes.data(), mCount * sizeof(std::uint32_t)) == 0 &&
+                                                    std::memcmp(alignments, mAlignments.data(), mCount * sizeof(std::uint32_t)) == 0));
+    }
+};
+
+/**
+ * @brief What the entity block of a snapshot holds, for checking the blocks after it.
+ */
+struct ECS_EXPORT SnapshotEntities
+{
+    Entity idCount = 0;
+    // Saved signature of every entity ID, by registration index
+    const std::uint32_t *signatures = nullptr;
+    // Components the signatures add up to, and entities with at least one
+    std::uint64_t componentCount = 0;
+    std::uint64_t entitiesWithComponents = 0;
+    // Scratch flags by entity ID, to catch an entity listed twice
+    std::vector<bool> seen{};
+
+    void ClearSeen()
+    {
+        seen.assign(idCount, false);
+    }
+
+    // Marks the entity as seen, false if it is out of range or was already seen
+    bool See(Entity entity)
+    {
+        if (entity >= idCount || seen[entity])
+        {
+            return false;
+        }
+
+        seen[entity] = true;
+        return true;
+    }
+};
+
 class ECS_EXPORT EntityManager
 {
 private:
-    // Queue of unused entity IDs
-    std::queue<Entity> mAvailableEntities{};
-    // Array of signatures where the index corresponds to the entity ID
-    std::array<Signature, MAX_ENTITIES> mSignatures{};
+    // Queue of destroyed entity IDs that can be handed out again, oldest first
+    std::pmr::deque<Entity> mAvailableEntities;
+    // Signatures where the index corresponds to the entity ID, grows with the highest ID handed out
+    std::pmr::vector<Signature> mSignatures;
+    // Next never used entity ID
+    Entity mNextEntity = 0;
     // Total living entities - used to keep limits on how many exist
     std::uint32_t mLivingEntityCount = 0;
 
-public:
-    EntityManager()
+public:
+    explicit EntityManager(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : mAvailableEntities(resource), mSignatures(resource)
+    {
+    }
+
+    /**
+     * @brief Reserves signature storage for the given number of entities.
+     */
+    void Reserve(std::size_t capacity)
+    {
+        mSignatures.reserve(capacity);
+    }
+
+    /**
+     * @brief Hands out the oldest destroyed ID, or a new one.
+     *
+     * @throws std::length_error if MAX_ENTITIES entities already exist.
+     */
+    Entity CreateEntity()
+    {
+        // Past the limit an ID would run into the sentinel and the provisional bit
+        if (mLivingEntityCount >= MAX_ENTITIES)
+        {
+            throw std::length_error("Too many entities in existence.");
+        }
+
+        Entity entity;
+        if (!mAvailableEntities.empty())
+        {
+            entity = mAvailableEntities.front();
+            mAvailableEntities.pop_front();
+        }
+        else
+        {
+            entity = mNextEntity++;
+            mSignatures.emplace_back();
+        }
+        ++mLivingEntityCount;
+
+        return entity;
+    }
+
+    void DestroyEntity(Entity entity)
+    {
+        assert(entity < mNextEntity && "Entity out of range.");
+
+        // Invalidate the destroyed entity's signature
+        mSignatures[entity].reset();
+
+        mAvailableEntities.push_back(entity);
+        --mLivingEntityCount;
+    }
+
+    void SetSignature(Entity entity, Signature signature)
+    {
+        assert(entity < mNextEntity && "Entity is out of range.");
+
+        mSignatures[entity] = signature;
+    }
+
+    Signature GetSignature(Entity entity) const
+    {
+        assert(entity < mNextEntity && "Entity is out of range.");
+
+        return mSignatures[entity];
+    }
+
+    std::uint32_t GetLivingEntityCount() const
+    {
+        return mLivingEntityCount;
+    }
+
+    // Entity IDs handed out so far, living or destroyed, every ID is below it
+    Entity GetIdCount() const
+    {
+        return mNextEntity;
+    }
+
+    /**
+     * @brief Forgets every entity, keeping the storage for the next ones.
+     */
+    void Clear()
+    {
+        mAvailableEntities.clear();
+        mSignatures.clear();
+        mNextEntity = 0;
+        mLivingEntityCount = 0;
+    }
+
+    /**
+     * @brief Writes the free IDs and the signatures, by registration index, see ComponentRegistry.
+     */
+    void Save(SnapshotWriter &writer, const ComponentRegistry &registry) const
+    {
+        writer.WriteValue(mNextEntity);
+        writer.WriteValue(mLivingEntityCount);
+        writer.WriteValue(std::uint32_t(mAvailableEntities.size()));
+
+        auto *available = reinterpret_cast<Entity *>(writer.Allocate(mAvailableEntities.size() * sizeof(Entity)));
+        std::copy(mAvailableEntities.begin(), mAvailableEntities.end(), available);
+
+        // One 32-bit word per entity, the in-memory layout of std::bitset is not portable
+        auto *signatures = reinterpret_cast<std::uint32_t *>(writer.Allocate(mSignatures.size() * sizeof(std::uint32_t)));
+        for (std::size_t entity = 0; entity < mSignatures.size(); ++entity)
+        {
+            signatures[entity] = registry.SaveSignature(mSignatures[entity]);
+        }
+    }
+
+    /**
+     * @brief Reads a block written by Save and checks it without loading it.
+     *
+     * @return false if it is truncated, or its free IDs or signatures are not consistent.
+     */
+    static bool Check(SnapshotReader &reader, const ComponentRegistry &registry, SnapshotEntities &entities)
+    {
+        auto idCount = reader.ReadValue<Entity>();
+        auto livingCount = reader.ReadValue<std::uint32_t>();
+        auto availableCount = reader.ReadValue<std::uint32_t>();
+        if (reader.Failed() || idCount > MAX_ENTITIES || availableCount > idCount || livingCount != idCount - availableCount ||
+            idCount > reader.Remaining() / sizeof(std::uint32_t))
+        {
+            return false;
+        }
+
+        auto *available = reinterpret_cast<const Entity *>(reader.Read(availableCount * sizeof(Entity)));
+        auto *signatures = reinterpret_cast<const std::uint32_t *>(reader.Read(idCount * sizeof(std::uint32_t)));
+        if (reader.Failed())
+        {
+            return false;
+        }
+
+        entities.idCount = idCount;
+        entities.signatures = signatures;
+        entities.componentCount = 0;
+        entities.entitiesWithComponents = 0;
+        for (Entity entity = 0; entity < idCount; ++entity)
+        {
+            if ((signatures[entity] & ~registry.ValidBits()) != 0)
+            {
+                return false;
+            }
+
+            entities.componentCount += Signature(signatures[entity]).count();
+            entities.entitiesWithComponents += signatures[entity] != 0;
+        }
+
+        // Destroyed entities have no components, and each is free once
+        entities.ClearSeen();
+        for (std::uint32_t i = 0; i < availableCount; ++i)
+        {
+            if (!entities.See(available[i]) || signatures[available[i]] != 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Replaces every entity with a block written by Save, that Check accepted.
+     */
+    void Load(SnapshotReader &reader, const ComponentRegistry &registry)
+    {
+        Clear();
+        mNextEntity = reader.ReadValue<Entity>();
+        mLivingEntityCount = reader.ReadValue<std::uint32_t>();
+        auto availableCount = reader.ReadValue<std::uint32_t>();
+
+        auto *available = reinterpret_cast<const Entity *>(reader.Read(availableCount * sizeof(Entity)));
+        mAvailableEntities.assign(available, available + availableCount);
+
+        auto *signatures = reinterpret_cast<const std::uint32_t *>(reader.Read(mNextEntity * sizeof(std::uint32_t)));
+        mSignatures.resize(mNextEntity);
+        for (std::size_t entity = 0; entity < mSignatures.size(); ++entity)
+        {
+            mSignatures[entity] = registry.LoadSignature(signatures[entity]);
+        }
+    }
+};
+
+class ECS_EXPORT IComponentArray
+{
+protected:
+    // Components per dense page, and entity IDs covered by one sparse page
+    static constexpr std::size_t DENSE_PAGE_SIZE = 1024;
+    static constexpr std::size_t SPARSE_PAGE_SIZE = 4096;
+
+    // Dense array of entity IDs, runs parallel to the packed component array of
+    // the derived ComponentArray. It lives here so the entities of any pool can be
+    // walked without knowing the component type.
+    PagedArray<Entity, DENSE_PAGE_SIZE> mDenseEntities;
+
+    // Total size of valid entries in the array.
+    std::size_t mSize{};
+
+    // Copies the first `size` elements of a dense array into one snapshot block
+    template <typename U>
+    static void SavePages(SnapshotWriter &writer, const PagedArray<U, DENSE_PAGE_SIZE> &pages, std::size_t size)
+    {
+        std::byte *block = writer.Allocate(size * sizeof(U));
+        for (std::size_t begin = 0; begin < size; begin += DENSE_PAGE_SIZE)
+        {
+            std::size_t count = std::min(DENSE_PAGE_SIZE, size - begin);
+            std::memcpy(block + begin * sizeof(U), &pages[begin], count * sizeof(U));
+        }
+    }
+
+    // Fills the first `size` elements of a dense array from a block written by SavePages
+    template <typename U>
+    static void LoadPages(SnapshotReader &reader, PagedArray<U, DENSE_PAGE_SIZE> &pages, std::size_t size)
+    {
+        const std::byte *block = reader.Read(size * sizeof(U));
+        pages.Reserve(size);
+        for (std::size_t begin = 0; begin < size; begin += DENSE_PAGE_SIZE)
+        {
+            std::size_t count = std::min(DENSE_PAGE_SIZE, size - begin);
+            std::memcpy(&pages[begin], block + begin * sizeof(U), count * sizeof(U));
+        }
+    }
+
+    explicit IComponentArray(std::pmr::memory_resource *resource)
+        : mDenseEntities(resource)
+    {
+    }
+
+public:
+    /**
+     * @brief Reads a pool written by Save and checks it without loading it.
+     *
+     * @param componentSize Size of the registered component.
+     * @param index Registration index of the component, its bit in the saved signatures.
+     * @return false if it is truncated, or its entities do not have the component in their signature.
+     */
+    static bool Check(SnapshotReader &reader, std::size_t componentSize, std::uint32_t index, SnapshotEntities &entities)
+    {
+        auto size = reader.ReadValue<std::uint64_t>();
+        auto savedSize = reader.ReadValue<std::uint64_t>();
+        if (reader.Failed() || savedSize != componentSize || size > entities.idCount ||
+            size > reader.Remaining() / (sizeof(Entity) + componentSize))
+        {
+            return false;
+        }
+
+        auto *dense = reinterpret_cast<const Entity *>(reader.Read(std::size_t(size) * sizeof(Entity)));
+        reader.Read(std::size_t(size) * componentSize);
+        if (reader.Failed())
+        {
+            return false;
+        }
+
+        entities.ClearSeen();
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            if (!entities.See(dense[i]) || ((entities.signatures[dense[i]] >> index) & 1u) == 0)
+            {
+                return false;
+            }
+        }
+
+        // Every pool is checked against the signatures, so the counts agree once all are read
+        entities.componentCount -= std::min(entities.componentCount, size);
+        return true;
+    }
+
+    virtual ~IComponentArray() = default;
+    virtual void EntityDestroyed(Entity entity) = 0;
+
+    /**
+     * @brief Writes the entities and the packed components as two raw blocks.
+     */
+    virtual void Save(SnapshotWriter &writer) const = 0;
+    /**
+     * @brief Replaces the contents with a pool written by Save, the blocks are copied page by page.
+     */
+    virtual void Load(SnapshotReader &reader) = 0;
+
+    std::size_t Size() const
+    {
+        return mSize;
+    }
+
+    // Entity stored at the given dense index, valid for indices below Size()
+    Entity EntityAt(std::size_t index) const
+    {
+        return mDenseEntities[index];
+    }
+};
+
+template <typename T>
+class ECS_EXPORT ComponentArray : public IComponentArray
+{
+private:
+    // The dense array of components, it is also called packed array
+    // because the components are stored next to each other in memory
+    // and there are no gaps between them. It grows a page at a time,
+    // so references stay valid while the array grows.
+    // mDenseEntities[i] owns mComponentArray[i].
+    PagedArray<T, DENSE_PAGE_SIZE> mComponentArray;
+    // Sparse array indexed by entity ID, holds the entity's index into the dense arrays.
+    // Pages are only allocated for ID ranges that hold at least one component, and
+    // entries are only meaningful for entities that pass Contains().
+    PagedArray<std::size_t, SPARSE_PAGE_SIZE> mSparse;
+
+public:
+    explicit ComponentArray(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : IComponentArray(resource), mComponentArray(resource), mSparse(resource)
+    {
+    }
+
+    /**
+     * @brief Allocates room for the given number of components up front.
+     *
+     * Only the dense arrays are reserved, sparse pages still follow the entity IDs in use.
+     */
+    void Reserve(std::size_t capacity)
+    {
+        mComponentArray.Reserve(capacity);
+        mDenseEntities.Reserve(capacity);
+    }
+
+    /**
+     * @brief Checks whether the entity has a component in this array.
+     *
+     * A sparse entry is valid only if it points inside the dense range and the dense
+     * slot points back at the same entity, so stale sparse entries never need clearing.
+     */
+    bool Contains(Entity entity) const
+    {
+        if (!mSparse.HasPage(mSparse.PageOf(entity)))
+        {
+            return false;
+        }
+
+        std::size_t index = mSparse[entity];
+        return index < mSize && mDenseEntities[index] == entity;
+    }
+
+    /**
+     * @brief Inserts the component at the end of the array, and updates the sparse index.
+     *
+     * @param entity The entity ID to associate with the component.
+     * @param component The component to add to the array.
+     *
+     * @note This method will assert if the entity already has a component in the array.
+     */
+    void InsertData(Entity entity, T component)
+    {
+        assert(!Contains(entity) && "Component added to same entity more than once.");
+
+        std::size_t newIndex = mSize;
+        mComponentArray.EnsurePage(mComponentArray.PageOf(newIndex));
+        mDenseEntities.EnsurePage(mDenseEntities.PageOf(newIndex));
+        mSparse.EnsurePage(mSparse.PageOf(entity));
+
+        mSparse[entity] = newIndex;
+        mDenseEntities[newIndex] = entity;
+        mComponentArray[newIndex] = component;
+        ++mSize;
+    }
+
+    /**
+     * @brief Removes a component from the array, and updates the sparse index.
+     *
+     * @param entity The entity ID to remove from the array.
+     *
+     * The remove process will swap the last element with the element to remove,
+     * and update the sparse index to point to the new location of the moved element.
+     *
+     * @note This method will assert if the entity does not have a component in the array.
+     */
+    void RemoveData(Entity entity)
+    {
+        assert(Contains(entity) && "Removing non-existent component.");
+
+        // First find the index of the component that will be removed
+        std::size_t indexOfRemovedEntity = mSparse[entity];
+        std::size_t indexOfLastElement = mSize - 1;
+        // Now swap the last element with the element to remove
+        mComponentArray[indexOfRemovedEntity] = mComponentArray[indexOfLastElement];
+
+        // Next update the dense and sparse arrays to point to the new location
+        Entity entityOfLastElement = mDenseEntities[indexOfLastElement];
+        mDenseEntities[indexOfRemovedEntity] = entityOfLastElement;
+        mSparse[entityOfLastElement] = indexOfRemovedEntity;
+
+        // Finally reduce the size, the removed entity's sparse entry is now stale
+        --mSize;
+    }
+
+    T &GetData(Entity entity)
+    {
+        assert(Contains(entity) && "Retrieving non-existent component.");
+
+        return mComponentArray[mSparse[entity]];
+    }
+
+    void EntityDestroyed(Entity entity) override
+    {
+        if (Contains(entity))
+        {
+            RemoveData(entity);
+        }
+    }
+
+    void Save(SnapshotWriter &writer) const override
+    {
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            writer.WriteValue(std::uint64_t(mSize));
+            writer.WriteValue(std::uint64_t(sizeof(T)));
+            SavePages(writer, mDenseEntities, mSize);
+            SavePages(writer, mComponentArray, mSize);
+        }
+        // Otherwise never called, SaveSnapshot refuses worlds with a pool of T
+    }
+
+    void Load(SnapshotReader &reader) override
+    {
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            // Checked by IComponentArray::Check before anything is loaded
+            auto size = std::size_t(reader.ReadValue<std::uint64_t>());
+            reader.ReadValue<std::uint64_t>();
+
+            LoadPages(reader, mDenseEntities, size);
+            LoadPages(reader, mComponentArray, size);
+            mSize = size;
+
+            // The sparse index is not saved, it follows from the dense entities
+            for (std::size_t index = 0; index < mSize; ++index)
+            {
+                Entity entity = mDenseEntities[index];
+                mSparse.EnsurePage(mSparse.PageOf(entity));
+                mSparse[entity] = index;
+            }
+        }
+        // Otherwise never called, LoadSnapshot refuses worlds with a pool of T
+    }
+};
+
+/**
+ * @brief Hands out sequential IDs per type, with an independent counter for each Family.
+ *
+ * The ID of a type is assigned the first time it is asked for and never changes,
+ * so lookups keyed by it are a plain array index.
+ */
+template <typename Family>
+class ECS_EXPORT TypeId
+{
+private:
+    static std::size_t Next()
+    {
+        static std::atomic<std::size_t> next{0};
+        return next++;
+    }
+
+public:
+    template <typename T>
+    static std::size_t Get()
+    {
+        static const std::size_t id = Next();
+        return id;
+    }
+};
+
+/**
+ * @brief The ComponentType of T, shared by every storage backend in the process.
+ */
+template <typename T>
+ComponentType ComponentTypeOf()
+{
+    std::size_t type = TypeId<IComponentArray>::Get<T>();
+
+    assert(type < MAX_COMPONENTS && "Too many component types.");
+
+    return static_cast<ComponentType>(type);
+}
+
+class ECS_EXPORT ComponentManager
+{
+private:
+    std::pmr::memory_resource *mResource;
+    // Pools indexed by ComponentType, a null entry means the type is not registered
+    std::pmr::vector<ResourcePtr<IComponentArray>> mComponentArrays;
+    // Registered types that cannot be copied as raw bytes into a snapshot
+    Signature mUnsnapshottable;
+    ComponentRegistry mRegistry;
+
+    template <typename T>
+    ComponentArray<T> &GetComponentArray()
+    {
+        ComponentType type = GetComponentType<T>();
+
+        assert(type < mComponentArrays.size() && mComponentArrays[type] != nullptr && "Component not registered before use.");
+
+        return static_cast<ComponentArray<T> &>(*mComponentArrays[type]);
+    }
+
+    template <typename T>
+    void InsertMany(const Entity *entities, std::size_t count, const T &component)
+    {
+        auto &componentArray = GetComponentArray<T>();
+        componentArray.Reserve(componentArray.Size() + count);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            componentArray.InsertData(entities[i], component);
+        }
+    }
+
+    // Visits the matching entities stored at [begin, end) of the smallest pool of a view
+    template <typename Fn, typename... Ts>
+    struct ViewRange
+    {
+        IComponentArray *driver;
+        std::tuple<ComponentArray<Ts> &...> pools;
+        Signature include;
+        Signature exclude;
+        const EntityManager &entityManager;
+        Fn &fn;
+
+        void operator()(std::size_t begin, std::size_t end) const
+        {
+            for (std::size_t index = begin; index < end; ++index)
+            {
+                Entity entity = driver->EntityAt(index);
+                Signature signature = entityManager.GetSignature(entity);
+
+                if ((signature & include) == include && (signature & exclude).none())
+                {
+                    fn(entity, std::get<ComponentArray<Ts> &>(pools).GetData(entity)...);
+                }
+            }
+        }
+    };
+
+    /**
+     * @brief Builds the range of a view over Ts, driven by the smallest pool among Ts.
+     *
+     * The other components are checked against the entity's signature, so no pool is
+     * probed for entities that cannot match.
+     */
+    template <typename... Ts, typename Fn>
+    ViewRange<Fn, Ts...> GetViewRange(Signature include, Signature exclude, const EntityManager &entityManager, Fn &fn)
+    {
+        static_assert(sizeof...(Ts) > 0, "A view needs at least one component.");
+
+        std::array<IComponentArray *, sizeof...(Ts)> arrays{&GetComponentArray<Ts>()...};
+
+        IComponentArray *driver = arrays[0];
+        for (IComponentArray *array : arrays)
+        {
+            if (array->Size() < driver->Size())
+            {
+                driver = array;
+            }
+        }
+
+        return ViewRange<Fn, Ts...>{driver, {GetComponentArray<Ts>()...}, include, exclude, entityManager, fn};
+    }
+
+public:
+    explicit ComponentManager(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : mResource(resource), mComponentArrays(resource)
+    {
+    }
+
+    /**
+     * @brief Registers a component type and creates its pool.
+     *
+     * @param capacityHint Number of components to allocate room for up front,
+     * the pool still grows past it on demand.
+     */
+    template <typename T>
+    void RegisterComponent(std::size_t capacityHint = 0)
+    {
+        ComponentType type = GetComponentType<T>();
+
+        if (type >= mComponentArrays.size())
+        {
+            mComponentArrays.resize(type + 1);
+        }
+
+        assert(mComponentArrays[type] == nullptr && "Registering component type more than once.");
+
+        auto componentArray = MakeResourcePtr<ComponentArray<T>>(mResource, mResource);
+        componentArray->Reserve(capacityHint);
+        mComponentArrays[type] = std::move(componentArray);
+        mUnsnapshottable.set(type, !std::is_trivially_copyable_v<T>);
+        mRegistry.Add(type, sizeof(T), alignof(T));
+    }
+
+    template <typename T>
+    ComponentType GetComponentType()
+    {
+        return ComponentTypeOf<T>();
+    }
+
+    template <typename T>
+    void AddComponent(Entity entity, T component)
+    {
+        GetComponentArray<T>().InsertData(entity, component);
+    }
+
+    template <typename T>
+    void RemoveComponent(Entity entity)
+    {
+        GetComponentArray<T>().RemoveData(entity);
+    }
+
+    /**
+     * @brief Inserts a copy of each component for every entity, the entities must have no components yet.
+     *
+     * Each pool is reserved once and filled in one sequential pass.
+     */
+    template <typename... Ts>
+    void InsertEntities(const Entity *entities, std::size_t count, const Ts &...components)
+    {
+        (InsertMany<Ts>(entities, count, components), ...);
+    }
+
+    template <typename T>
+    void AddComponents(const Entity *entities, std::size_t count, const T &component)
+    {
+        InsertMany<T>(entities, count, component);
+    }
+
+    template <typename T>
+    void RemoveComponents(const Entity *entities, std::size_t count)
+    {
+        auto &componentArray = GetComponentArray<T>();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            componentArray.RemoveData(entities[i]);
+        }
+    }
+
+    template <typename T>
+    T &GetComponent(Entity entity)
+    {
+        return GetComponentArray<T>().GetData(entity);
+    }
+
+    /**
+     * @brief Calls fn(entity, Ts &...) for every entity whose signature has all of include and none of exclude.
+     *
+     * Walks the dense entities of the smallest pool among Ts, see GetViewRange.
+     */
+    template <typename... Ts, typename Fn>
+    void Each(Signature include, Signature exclude, const EntityManager &entityManager, Fn &&fn)
+    {
+        auto range = GetViewRange<Ts...>(include, exclude, entityManager, fn);
+        range(std::size_t{0}, range.driver->Size());
+    }
+
+    /**
+     * @brief Each, with the dense range of the smallest pool split into chunks that run on the thread pool.
+     */
+    template <typename... Ts, typename Fn>
+    void ParallelEach(Signature include, Signature exclude, const EntityManager &entityManager, ThreadPool &pool, Fn &&fn)
+    {
+        auto range = GetViewRange<Ts...>(include, exclude, entityManager, fn);
+        ParallelFor(pool, range.driver->Size(), range);
+    }
+
+    /**
+     * @brief Removes the entity from the pools of every component in its signature.
+     */
+    void EntityDestroyed(Entity entity, Signature signature)
+    {
+        for (ComponentType type = 0; type < mComponentArrays.size(); ++type)
+        {
+            if (signature.test(type))
+            {
+                mComponentArrays[type]->EntityDestroyed(entity);
+            }
+        }
+    }
+
+    // Tells the storages apart in snapshots
+    static constexpr std::uint32_t SNAPSHOT_STORAGE = 0;
+
+    // Whether every registered component is trivially copyable, as snapshots need
+    bool CanSnapshot() const
+    {
+        return mUnsnapshottable.none();
+    }
+
+    const ComponentRegistry &GetRegistry() const
+    {
+        return mRegistry;
+    }
+
+    /**
+     * @brief Writes every registered pool in registration order, see ComponentArray::Save.
+     */
+    void Save(SnapshotWriter &writer) const
+    {
+        for (std::uint32_t index = 0; index < mRegistry.Count(); ++index)
+        {
+            mComponentArrays[mRegistry.TypeAt(index)]->Save(writer);
+        }
+    }
+
+    /**
+     * @brief Reads the pools written by Save and checks them against the saved signatures.
+     */
+    bool Check(SnapshotReader &reader, SnapshotEntities &entities) const
+    {
+        for (std::uint32_t index = 0; index < mRegistry.Count(); ++index)
+        {
+            if (!IComponentArray::Check(reader, mRegistry.SizeAt(index), index, entities))
+            {
+                return false;
+            }
+        }
+
+        // Each entity of a pool has the component, so matching totals mean no entity is missing one
+        return entities.componentCount == 0;
+    }
+
+    /**
+     * @brief Refills the pools from a snapshot whose registry matches this one.
+     */
+    void Load(SnapshotReader &reader)
+    {
+        for (std::uint32_t index = 0; index < mRegistry.Count(); ++index)
+        {
+            mComponentArrays[mRegistry.TypeAt(index)]->Load(reader);
+        }
+    }
+};
+
+/**
+ * @brief Type-erased operations the archetype storage needs to move components between chunks.
+ */
+struct ECS_EXPORT ComponentInfo
+{
+    std::size_t size = 0;
+    std::size_t alignment = 0;
+    // Move-constructs the component at src into the uninitialized memory at dst
+    void (*moveConstruct)(void *dst, void *src) = nullptr;
+    void (*destroy)(void *component) = nullptr;
+    // Whether chunks holding the component can be saved as raw bytes
+    bool triviallyCopyable = false;
+
+    template <typename T>
+    static ComponentInfo Of()
+    {
+        ComponentInfo info;
+        info.size = sizeof(T);
+        info.alignment = alignof(T);
+        info.triviallyCopyable = std::is_trivially_copyable_v<T>;
+        info.moveConstruct = [](void *dst, void *src)
+        { new (dst) T(std::move(*static_cast<T *>(src))); };
+        info.destroy = [](void *component)
+        { static_cast<T *>(component)->~T(); };
+
+        return info;
+    }
+};
+
+/**
+ * @brief Stores every entity that has exactly the same Signature.
+ *
+ * Rows are packed into fixed-size chunks laid out as structure-of-arrays: each chunk holds
+ * an entity column followed by one column per component type, so iterating several
+ * components of an archetype reads each column sequentially. Removing a row moves the
+ * last row into the hole, the same way ComponentArray does.
+ *
+ * A row that does not fit in CHUNK_SIZE gets chunks of one row, as large as the row needs.
+ */
+class ECS_EXPORT Archetype
+{
+public:
+    static constexpr std::size_t CHUNK_SIZE = 16 * 1024;
+    static constexpr std::size_t CHUNK_ALIGNMENT = 64;
+
+private:
+    std::pmr::memory_resource *mResource;
+    Signature mSignature;
+    // Component types in the signature, in registration order so the chunk layout is the
+    // same in every run that registers the same components
+    std::pmr::vector<ComponentType> mTypes;
+    // Byte offset of each component column inside a chunk, indexed by ComponentType
+    std::array<std::size_t, MAX_COMPONENTS> mColumnOffsets{};
+    std::array<ComponentInfo, MAX_COMPONENTS> mInfos{};
+    // Rows that fit in one chunk, and the bytes of each chunk, CHUNK_SIZE unless a row is larger
+    std::size_t mChunkCapacity = 0;
+    std::size_t mChunkBytes = CHUNK_SIZE;
+    std::pmr::vector<std::byte *> mChunks;
+    // Total rows in use across all chunks
+    std::size_t mSize = 0;
+
+    // Archetypes reached by adding or removing one component type, filled in lazily
+    std::array<Archetype *, MAX_COMPONENTS> mAddEdges{};
+    std::array<Archetype *, MAX_COMPONENTS> mRemoveEdges{};
+
+    friend class ArchetypeManager;
+
+    // Lays out the columns for a given number of rows, returns the bytes used
+    std::size_t Layout(std::size_t rows)
+    {
+        std::size_t offset = sizeof(Entity) * rows;
+
+        for (ComponentType type : mTypes)
+        {
+            std::size_t alignment = mInfos[type].alignment;
+            offset = (offset + alignment - 1) / alignment * alignment;
+            mColumnOffsets[type] = offset;
+            offset += mInfos[type].size * rows;
+        }
+
+        return offset;
+    }
+
+    void AppendChunk()
+    {
+        mChunks.push_back(static_cast<std::byte *>(mResource->allocate(mChunkBytes, CHUNK_ALIGNMENT)));
+    }
+
+    // Copies the rows in use of the column at `offset` in every chunk into one snapshot block
+    void SaveColumn(SnapshotWriter &writer, std::size_t offset, std::size_t elementSize) const
+    {
+        std::byte *block = writer.Allocate(mSize * elementSize);
+        for (std::size_t chunk = 0; chunk < ChunkCount(); ++chunk)
+        {
+            std::memcpy(block + chunk * mChunkCapacity * elementSize, mChunks[chunk] + offset, ChunkSize(chunk) * elementSize);
+        }
+    }
+
+    // Fills the column at `offset` of the chunks in use from a block written by SaveColumn
+    void LoadColumn(const std::byte *block, std::size_t offset, std::size_t elementSize)
+    {
+        for (std::size_t chunk = 0; chunk < ChunkCount(); ++chunk)
+        {
+            std::memcpy(mChunks[chunk] + offset, block + chunk * mChunkCapacity * elementSize, ChunkSize(chunk) * elementSize);
+        }
+    }
+
+public:
+    Archetype(Signature signature, const std::array<ComponentInfo, MAX_COMPONENTS> &infos, const ComponentRegistry &registry,
+              std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : mResource(resource), mSignature(signature), mTypes(resource), mChunks(resource)
+    {
+        assert((signature & ~registry.LoadSignature(registry.ValidBits())).none() && "Component not registered before use.");
+
+        std::size_t rowSize = sizeof(Entity);
+
+        for (std::uint32_t index = 0; index < registry.Count(); ++index)
+        {
+            ComponentType type = registry.TypeAt(index);
+            if (signature.test(type))
+            {
+                assert(infos[type].size > 0 && "Component not registered before use.");
+                assert(infos[type].alignment <= CHUNK_ALIGNMENT && "Component alignment exceeds the chunk alignment.");
+
+                mTypes.push_back(type);
+                mInfos[type] = infos[type];
+                rowSize += infos[type].size;
+            }
+        }
+
+        // Start from the unpadded estimate and shrink until the padded layout fits
+        mChunkCapacity = std::max<std::size_t>(CHUNK_SIZE / rowSize, 1);
+        while (mChunkCapacity > 1 && Layout(mChunkCapacity) > CHUNK_SIZE)
+        {
+            --mChunkCapacity;
+        }
+
+        // Only a single row can outgrow a chunk, its chunks grow to fit it
+        std::size_t used = Layout(mChunkCapacity);
+        if (used > CHUNK_SIZE)
+        {
+            mChunkBytes = (used + CHUNK_ALIGNMENT - 1) / CHUNK_ALIGNMENT * CHUNK_ALIGNMENT;
+        }
+    }
+
+    ~Archetype()
+    {
+        for (std::size_t row = 0; row < mSize; ++row)
+        {
+            for (ComponentType type : mTypes)
+            {
+                mInfos[type].destroy(GetComponent(type, row));
+            }
+        }
+
+        for (std::byte *chunk : mChunks)
+        {
+            mResource->deallocate(chunk, mChunkBytes, CHUNK_ALIGNMENT);
+        }
+    }
+
+    Archetype(const Archetype &) = delete;
+    Archetype &operator=(const Archetype &) = delete;
+
+    Signature GetSignature() const
+    {
+        return mSignature;
+    }
+
+    std::size_t Size() const
+    {
+        return mSize;
+    }
+
+    std::size_t ChunkCapacity() const
+    {
+        return mChunkCapacity;
+    }
+
+    std::size_t ChunkCount() const
+    {
+        return (mSize + mChunkCapacity - 1) / mChunkCapacity;
+    }
+
+    // Rows in use in the given chunk, every chunk but the last one is full
+    std::size_t ChunkSize(std::size_t chunk) const
+    {
+        return chunk + 1 < ChunkCount() ? mChunkCapacity : mSize - chunk * mChunkCapacity;
+    }
+
+    Entity *Entities(std::size_t chunk)
+    {
+        return reinterpret_cast<Entity *>(mChunks[chunk]);
+    }
+
+    template <typename T>
+    T *Column(ComponentType type, std::size_t chunk)
+    {
+        assert(mSignature.test(type) && "Archetype does not have the component.");
+
+        return reinterpret_cast<T *>(mChunks[chunk] + mColumnOffsets[type]);
+    }
+
+    void *GetComponent(ComponentType type, std::size_t row)
+    {
+        assert(mSignature.test(type) && "Archetype does not have the component.");
+
+        std::byte *chunk = mChunks[row / mChunkCapacity];
+        return chunk + mColumnOffsets[type] + (row % mChunkCapacity) * mInfos[type].size;
+    }
+
+    /**
+     * @brief Appends chunks until the archetype can hold the given number of rows.
+     */
+    void Reserve(std::size_t rows)
+    {
+        std::size_t chunks = (rows + mChunkCapacity - 1) / mChunkCapacity;
+        mChunks.reserve(chunks);
+        while (mChunks.size() < chunks)
+        {
+            AppendChunk();
+        }
+    }
+
+    /**
+     * @brief Appends a row for the entity, its component slots are left uninitialized.
+     */
+    std::size_t AllocateRow(Entity entity)
+    {
+        std::size_t row = mSize;
+        if (row / mChunkCapacity == mChunks.size())
+        {
+            AppendChunk();
+        }
+
+        Entities(row / mChunkCapacity)[row % mChunkCapacity] = entity;
+        ++mSize;
+
+        return row;
+    }
+
+    /**
+     * @brief Destroys the components in the row and moves the last row into its place.
+     *
+     * @return The entity that now lives in the row, or the removed entity if it was the last row.
+     */
+    Entity RemoveRow(std::size_t row)
+    {
+        assert(row < mSize && "Removing non-existent row.");
+
+        std::size_t last = mSize - 1;
+        Entity *lastEntity = &Entities(last / mChunkCapacity)[last % mChunkCapacity];
+        Entity movedEntity = *lastEntity;
+
+        for (ComponentType type : mTypes)
+        {
+            void *component = GetComponent(type, row);
+            mInfos[type].destroy(component);
+
+            if (row != last)
+            {
+                void *lastComponent = GetComponent(type, last);
+                mInfos[type].moveConstruct(component, lastComponent);
+                mInfos[type].destroy(lastComponent);
+            }
+        }
+
+        Entities(row / mChunkCapacity)[row % mChunkCapacity] = movedEntity;
+        --mSize;
+
+        return movedEntity;
+    }
+};
+
+/**
+ * @brief Component storage backend that groups entities by Signature into Archetype chunks.
+ *
+ * Drop-in alternative to ComponentManager. Adding or removing a component moves the
+ * entity's whole row to another archetype, so component references are only stable
+ * until the entity's next structural change.
+ */
+class ECS_EXPORT ArchetypeManager
+{
+private:
+    struct EntityLocation
+    {
+        Archetype *archetype = nullptr;
+        std::size_t row = 0;
+    };
+
+    std::pmr::memory_resource *mResource;
+    std::array<ComponentInfo, MAX_COMPONENTS> mInfos{};
+    ComponentRegistry mRegistry;
+    std::pmr::unordered_map<Signature, ResourcePtr<Archetype>> mArchetypes;
+    // Archetypes in creation order, so iteration does not depend on hashing
+    std::pmr::vector<Archetype *> mArchetypeList;
+    // Where each entity's row lives, indexed by entity ID
+    std::pmr::vector<EntityLocation> mLocations;
+    // Archetypes reached from an entity with no components, by the first component added
+    std::array<Archetype *, MAX_COMPONENTS> mRootEdges{};
+
+    template <typename... Ts, typename Fn>
+    void EachInChunk(Archetype &archetype, std::size_t chunk, Fn &fn)
+    {
+        std::size_t count = archetype.ChunkSize(chunk);
+        Entity *entities = archetype.Entities(chunk);
+        auto columns = std::make_tuple(archetype.Column<Ts>(GetComponentType<Ts>(), chunk)...);
+
+        for (std::size_t row = 0; row < count; ++row)
+        {
+            fn(entities[row], std::get<Ts *>(columns)[row]...);
+        }
+    }
+
+    Archetype *GetArchetype(Signature signature)
+    {
+        if (signature.none())
+        {
+            return nullptr;
+        }
+
+        auto found = mArchetypes.find(signature);
+        if (found != mArchetypes.end())
+        {
+            return found->second.get();
+        }
+
+        auto archetype = MakeResourcePtr<Archetype>(mResource, signature, mInfos, mRegistry, mResource);
+        Archetype *result = archetype.get();
+        mArchetypes.emplace(signature, std::move(archetype));
+        mArchetypeList.push_back(result);
+
+        return result;
+    }
+
+    EntityLocation &GetLocation(Entity entity)
+    {
+        if (entity >= mLocations.size())
+        {
+            mLocations.resize(entity + 1);
+        }
+
+        return mLocations[entity];
+    }
+
+    /**
+     * @brief Moves the entity's row to the archetype with the given signature.
+     *
+     * Components present in both archetypes are moved over, the ones that are only
+     * in the source are destroyed. Components only in the destination are left for
+     * the caller to construct.
+     */
+    void MoveEntity(Entity entity, Archetype *destination)
+    {
+        EntityLocation &location = GetLocation(entity);
+        Archetype *source = location.archetype;
+
+        std::size_t newRow = 0;
+        if (destination != nullptr)
+        {
+            newRow = destination->AllocateRow(entity);
+
+            if (source != nullptr)
+            {
+                for (ComponentType type : source->mTypes)
+                {
+                    if (destination->mSignature.test(type))
+                    {
+                        mInfos[type].moveConstruct(destination->GetComponent(type, newRow), source->GetComponent(type, location.row));
+                    }
+                }
+            }
+        }
+
+        if (source != nullptr)
+        {
+            Entity movedEntity = source->RemoveRow(location.row);
+            if (movedEntity != entity)
+            {
+                mLocations[movedEntity].row = location.row;
+            }
+        }
+
+        location.archetype = destination;
+        location.row = newRow;
+    }
+
+    /**
+     * @brief Moves the rows of entities that all live in source to destination.
+     *
+     * Same as calling MoveEntity for each entity, but the destination is reserved once
+     * and each shared component column is moved over in one sequential pass.
+     */
+    void MoveEntities(const Entity *entities, std::size_t count, Archetype *source, Archetype *destination)
+    {
+        std::size_t firstRow = destination != nullptr ? destination->Size() : 0;
+        if (destination != nullptr)
+        {
+            destination->Reserve(firstRow + count);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                destination->AllocateRow(entities[i]);
+            }
+
+            if (source != nullptr)
+            {
+                for (ComponentType type : source->mTypes)
+                {
+                    if (!destination->mSignature.test(type))
+                    {
+                        continue;
+                    }
+
+                    for (std::size_t i = 0; i < count; ++i)
+                    {
+                        mInfos[type].moveConstruct(destination->GetComponent(type, firstRow + i),
+                                                   source->GetComponent(type, mLocations[entities[i]].row));
+                    }
+                }
+            }
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            EntityLocation &location = GetLocation(entities[i]);
+
+            if (source != nullptr)
+            {
+                // A row swapped in from the back may belong to a later entity of the batch,
+                // its location still points into source until its own turn
+                Entity movedEntity = source->RemoveRow(location.row);
+                if (movedEntity != entities[i])
+                {
+                    mLocations[movedEntity].row = location.row;
+                }
+            }
+
+            location.archetype = destination;
+            location.row = destination != nullptr ? firstRow + i : 0;
+        }
+    }
+
+    /**
+     * @brief Calls fn(source, entities, count) once for each archetype the entities live in.
+     *
+     * Groups keep the order in which their first entity appears, and the entities keep
+     * their order inside each group.
+     */
+    template <typename Fn>
+    void EachSourceGroup(const Entity *entities, std::size_t count, Fn &&fn)
+    {
+        std::pmr::vector<Entity> pending(entities, entities + count, mResource);
+
+        auto begin = pending.begin();
+        while (begin != pending.end())
+        {
+            Archetype *source = GetLocation(*begin).archetype;
+            auto end = std::stable_partition(begin, pending.end(), [&](Entity entity)
+                                             { return GetLocation(entity).archetype == source; });
+
+            fn(source, &*begin, std::size_t(end - begin));
+            begin = end;
+        }
+    }
+
+public:
+    explicit ArchetypeManager(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : mResource(resource), mArchetypes(resource), mArchetypeList(resource), mLocations(resource)
+    {
+    }
+
+    /**
+     * @brief Registers a component type.
+     *
+     * @param capacityHint Accepted for parity with ComponentManager, chunks are
+     * allocated per archetype so there is no single pool to size.
+     */
+    template <typename T>
+    void RegisterComponent(std::size_t capacityHint = 0)
+    {
+        (void)capacityHint;
+        ComponentType type = GetComponentType<T>();
+
+        assert(mInfos[type].size == 0 && "Registering component type more than once.");
+
+        mInfos[type] = ComponentInfo::Of<T>();
+        mRegistry.Add(type, sizeof(T), alignof(T));
+    }
+
+    template <typename T>
+    ComponentType GetComponentType()
+    {
+        return ComponentTypeOf<T>();
+    }
+
+    template <typename T>
+    void AddComponent(Entity entity, T component)
+    {
+        ComponentType type = GetComponentType<T>();
+        Archetype *source = GetLocation(entity).archetype;
+
+        assert((source == nullptr || !source->mSignature.test(type)) && "Component added to same entity more than once.");
+
+        Archetype *&edge = source != nullptr ? source->mAddEdges[type] : mRootEdges[type];
+        if (edge == nullptr)
+        {
+            Signature signature = source != nullptr ? source->mSignature : Signature{};
+            edge = GetArchetype(signature.set(type));
+        }
+
+        MoveEntity(entity, edge);
+
+        EntityLocation &location = mLocations[entity];
+        new (location.archetype->GetComponent(type, location.row)) T(std::move(component));
+    }
+
+    template <typename T>
+    void RemoveComponent(Entity entity)
+    {
+        ComponentType type = GetComponentType<T>();
+        Archetype *source = GetLocation(entity).archetype;
+
+        assert(source != nullptr && source->mSignature.test(type) && "Removing non-existent component.");
+
+        Archetype *&edge = source->mRemoveEdges[type];
+        if (edge == nullptr)
+        {
+            edge = GetArchetype(Signature{source->mSignature}.reset(type));
+        }
+
+        MoveEntity(entity, edge);
+    }
+
+    /**
+     * @brief Inserts a copy of each component for every entity, the entities must have no components yet.
+     *
+     * The rows are appended straight to the archetype of the full signature, without
+     * passing through the archetypes of the partial signatures.
+     */
+    template <typename... Ts>
+    void InsertEntities(const Entity *entities, std::size_t count, const Ts &...components)
+    {
+        Signature signature;
+        (signature.set(GetComponentType<Ts>()), ...);
+        Archetype *archetype = GetArchetype(signature);
+        archetype->Reserve(archetype->Size() + count);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            EntityLocation &location = GetLocation(entities[i]);
+            assert(location.archetype == nullptr && "Entity already has components.");
+
+            location.archetype = archetype;
+            location.row = archetype->AllocateRow(entities[i]);
+            (new (archetype->GetComponent(GetComponentType<Ts>(), location.row)) Ts(components), ...);
+        }
+    }
+
+    /**
+     * @brief Adds a copy of the component to every entity.
+     *
+     * The entities are grouped by the archetype they live in, and each group's rows are
+     * moved to the target archetype together, see MoveEntities.
+     */
+    template <typename T>
+    void AddComponents(const Entity *entities, std::size_t count, const T &component)
+    {
+        ComponentType type = GetComponentType<T>();
+
+        EachSourceGroup(entities, count, [&](Archetype *source, const Entity *group, std::size_t groupCount)
+                        {
+            assert((source == nullptr || !source->mSignature.test(type)) && "Component added to same entity more than once.");
+
+            Archetype *&edge = source != nullptr ? source->mAddEdges[type] : mRootEdges[type];
+            if (edge == nullptr)
+            {
+                Signature signature = source != nullptr ? source->mSignature : Signature{};
+                edge = GetArchetype(signature.set(type));
+            }
+
+            std::size_t firstRow = edge->Size();
+            MoveEntities(group, groupCount, source, edge);
+
+            for (std::size_t i = 0; i < groupCount; ++i)
+            {
+                new (edge->GetComponent(type, firstRow + i)) T(component);
+            } });
+    }
+
+    /**
+     * @brief Removes the component from every entity, grouped by archetype like AddComponents.
+     */
+    template <typename T>
+    void RemoveComponents(const Entity *entities, std::size_t count)
+    {
+        ComponentType type = GetComponentType<T>();
+
+        EachSourceGroup(entities, count, [&](Archetype *source, const Entity *group, std::size_t groupCount)
+                        {
+            assert(source != nullptr && source->mSignature.test(type) && "Removing non-existent component.");
+
+            Archetype *&edge = source->mRemoveEdges[type];
+            if (edge == nullptr)
+            {
+                edge = GetArchetype(Signature{source->mSignature}.reset(type));
+            }
+
+            MoveEntities(group, groupCount, source, edge); });
+    }
+
+    template <typename T>
+    T &GetComponent(Entity entity)
+    {
+        assert(entity < mLocations.size() && mLocations[entity].archetype != nullptr && "Retrieving non-existent component.");
+
+        EntityLocation &location = mLocations[entity];
+        return *static_cast<T *>(location.archetype->GetComponent(GetComponentType<T>(), location.row));
+    }
+
+    void EntityDestroyed(Entity entity, Signature signature)
+    {
+        if (signature.any())
+        {
+            MoveEntity(entity, nullptr);
+        }
+    }
+
+    /**
+     * @brief Calls fn(entity, Ts &...) for every entity whose signature has all of include and none of exclude.
+     *
+     * Walks the matching archetypes chunk by chunk, reading each component column sequentially.
+     */
+    template <typename... Ts, typename Fn>
+    void Each(Signature include, Signature exclude, const EntityManager &entityManager, Fn &&fn)
+    {
+        static_assert(sizeof...(Ts) > 0, "A view needs at least one component.");
+        (void)entityManager;
+
+        for (Archetype *archetype : mArchetypeList)
+        {
+            Signature signature = archetype->GetSignature();
+            if ((signature & include) == include && (signature & exclude).none())
+            {
+                for (std::size_t chunk = 0; chunk < archetype->ChunkCount(); ++chunk)
+                {
+                    EachInChunk<Ts...>(*archetype, chunk, fn);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Each, with the chunks of the matching archetypes spread over the thread pool.
+     */
+    template <typename... Ts, typename Fn>
+    void ParallelEach(Signature include, Signature exclude, const EntityManager &entityManager, ThreadPool &pool, Fn &&fn)
+    {
+        static_assert(sizeof...(Ts) > 0, "A view needs at least one component.");
+        (void)entityManager;
+
+        std::vector<std::pair<Archetype *, std::size_t>> chunks;
+        for (Archetype *archetype : mArchetypeList)
+        {
+            Signature signature = archetype->GetSignature();
+            if ((signature & include) == include && (signature & exclude).none())
+            {
+                for (std::size_t chunk = 0; chunk < archetype->ChunkCount(); ++chunk)
+                {
+                    chunks.emplace_back(archetype, chunk);
+                }
+            }
+        }
+
+        // A chunk already holds up to CHUNK_SIZE bytes of rows, so each one is a task
+        ParallelFor(
+            pool, chunks.size(), [&](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    EachInChunk<Ts...>(*chunks[i].first, chunks[i].second, fn);
+                } },
+            1);
+    }
+
+    const std::pmr::vector<Archetype *> &GetArchetypes() const
+    {
+        return mArchetypeList;
+    }
+
+    // Tells the storages apart in snapshots
+    static constexpr std::uint32_t SNAPSHOT_STORAGE = 1;
+
+    // Whether every registered component is trivially copyable, as snapshots need
+    bool CanSnapshot() const
+    {
+        for (const ComponentInfo &info : mInfos)
+        {
+            if (info.size > 0 && !info.triviallyCopyable)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    const ComponentRegistry &GetRegistry() const
+    {
+        return mRegistry;
+    }
+
+    /**
+     * @brief Writes every archetype's signature and row count, then its entity column and each
+     * component column in registration order, as one raw block per column.
+     *
+     * Only the rows in use are written, so neither the free tail of the last chunk nor rows
+     * left behind by removals end up in the snapshot.
+     */
+    void Save(SnapshotWriter &writer) const
+    {
+        writer.WriteValue(std::uint32_t(mArchetypeList.size()));
+
+        for (const Archetype *archetype : mArchetypeList)
+        {
+            writer.WriteValue(mRegistry.SaveSignature(archetype->mSignature));
+            writer.WriteValue(std::uint64_t(archetype->mSize));
+            archetype->SaveColumn(writer, 0, sizeof(Entity));
+            for (ComponentType type : archetype->mTypes)
+            {
+                archetype->SaveColumn(writer, archetype->mColumnOffsets[type], mInfos[type].size);
+            }
+        }
+    }
+
+    /**
+     * @brief Reads the archetypes written by Save and checks their rows against the saved signatures.
+     */
+    bool Check(SnapshotReader &reader, SnapshotEntities &entities) const
+    {
+        auto count = reader.ReadValue<std::uint32_t>();
+        if (reader.Failed() || count > reader.Remaining() / (2 * sizeof(std::uint64_t)))
+        {
+            return false;
+        }
+
+        std::vector<std::uint32_t> signatures;
+        signatures.reserve(count);
+        std::uint64_t rows = 0;
+        entities.ClearSeen();
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            auto bits = reader.ReadValue<std::uint32_t>();
+            auto size = reader.ReadValue<std::uint64_t>();
+            if (reader.Failed() || bits == 0 || (bits & ~mRegistry.ValidBits()) != 0 || size > entities.idCount)
+            {
+                return false;
+            }
+
+            std::size_t rowBytes = sizeof(Entity);
+            for (std::uint32_t index = 0; index < mRegistry.Count(); ++index)
+            {
+                rowBytes += (bits >> index) & 1u ? mInfos[mRegistry.TypeAt(index)].size : 0;
+            }
+            if (size > reader.Remaining() / rowBytes)
+            {
+                return false;
+            }
+
+            auto *rowEntities = reinterpret_cast<const Entity *>(reader.Read(std::size_t(size) * sizeof(Entity)));
+            for (std::size_t row = 0; row < size; ++row)
+            {
+                if (!entities.See(rowEntities[row]) || entities.signatures[rowEntities[row]] != bits)
+                {
+                    return false;
+                }
+            }
+
+            for (std::uint32_t index = 0; index < mRegistry.Count(); ++index)
+            {
+                if ((bits >> index) & 1u)
+                {
+                    reader.Read(std::size_t(size) * mInfos[mRegistry.TypeAt(index)].size);
+                }
+            }
+
+            signatures.push_back(bits);
+            rows += size;
+        }
+
+        // Each archetype once, and every entity with components in one of them
+        std::sort(signatures.begin(), signatures.end());
+        return !reader.Failed() && std::adjacent_find(signatures.begin(), signatures.end()) == signatures.end() &&
+               rows == entities.entitiesWithComponents;
+    }
+
+    /**
+     * @brief Replaces every archetype with the ones of a snapshot whose registry matches this one.
+     *
+     * The columns are copied into fresh chunks laid out by this manager, and the entity
+     * locations are rebuilt from the entity columns.
+     */
+    void Load(SnapshotReader &reader)
+    {
+        mArchetypes.clear();
+        mArchetypeList.clear();
+        mLocations.clear();
+        mRootEdges = {};
+
+        auto count = reader.ReadValue<std::uint32_t>();
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            Signature signature = mRegistry.LoadSignature(reader.ReadValue<std::uint32_t>());
+            auto size = std::size_t(reader.ReadValue<std::uint64_t>());
+            Archetype *archetype = GetArchetype(signature);
+
+            archetype->Reserve(size);
+            archetype->mSize = size;
+
+            archetype->LoadColumn(reader.Read(size * sizeof(Entity)), 0, sizeof(Entity));
+            for (ComponentType type : archetype->mTypes)
+            {
+                archetype->LoadColumn(reader.Read(size * mInfos[type].size), archetype->mColumnOffsets[type], mInfos[type].size);
+            }
+
+            for (std::size_t row = 0; row < size; ++row)
+            {
+                Entity entity = archetype->Entities(row / archetype->mChunkCapacity)[row % archetype->mChunkCapacity];
+                GetLocation(entity) = EntityLocation{archetype, row};
+            }
+        }
+    }
+};
+
+/**
+ * @brief Set of entities stored as a sparse set, iterated over a contiguous dense array.
+ *
+ * Insert, Erase and Contains are O(1) with no hashing or node allocation. Erase moves the
+ * last entity into the hole, so iteration order is not sorted and is not stable across erases.
+ */
+class ECS_EXPORT EntitySet
+{
+private:
+    static constexpr std::size_t SPARSE_PAGE_SIZE = 4096;
+
+    std::pmr::vector<Entity> mDense;
+    // Index into mDense for each entity ID, only meaningful for entities that pass Contains()
+    PagedArray<std::size_t, SPARSE_PAGE_SIZE> mSparse;
+
+public:
+    using const_iterator = std::pmr::vector<Entity>::const_iterator;
+
+    explicit EntitySet(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : mDense(resource), mSparse(resource)
+    {
+    }
+
+    /**
+     * @brief Empties the set and moves its storage to another memory resource.
+     *
+     * Containers keep the resource they were built with, so both are built again.
+     */
+    void Reset(std::pmr::memory_resource *resource)
+    {
+        std::destroy_at(&mSparse);
+        std::destroy_at(&mDense);
+        new (&mDense) std::pmr::vector<Entity>(resource);
+        new (&mSparse) PagedArray<std::size_t, SPARSE_PAGE_SIZE>(resource);
+    }
+
+    bool Contains(Entity entity) const
+    {
+        if (!mSparse.HasPage(mSparse.PageOf(entity)))
+        {
+            return false;
+        }
+
+        std::size_t index = mSparse[entity];
+        return index < mDense.size() && mDense[index] == entity;
+    }
+
+    void Insert(Entity entity)
+    {
+        if (Contains(entity))
+        {
+            return;
+        }
+
+        mSparse.EnsurePage(mSparse.PageOf(entity));
+        mSparse[entity] = mDense.size();
+        mDense.push_back(entity);
+    }
+
+    void Erase(Entity entity)
+    {
+        if (!Contains(entity))
+        {
+            return;
+        }
+
+        std::size_t index = mSparse[entity];
+        Entity last = mDense.back();
+        mDense[index] = last;
+        mSparse[last] = index;
+        mDense.pop_back();
+    }
+
+    void Reserve(std::size_t capacity)
+    {
+        mDense.reserve(capacity);
+    }
+
+    /**
+     * @brief Replaces the contents with the given entities, kept in that order.
+     */
+    void Assign(const Entity *entities, std::size_t count)
+    {
+        mDense.assign(entities, entities + count);
+
+        for (std::size_t index = 0; index < count; ++index)
+        {
+            mSparse.EnsurePage(mSparse.PageOf(entities[index]));
+            mSparse[entities[index]] = index;
+        }
+    }
+
+    std::size_t Size() const
+    {
+        return mDense.size();
+    }
+
+    bool Empty() const
+    {
+        return mDense.empty();
+    }
+
+    const Entity *Data() const
+    {
+        return mDense.data();
+    }
+
+    /**
+     * @brief Calls fn(entity) for every entity, with the dense array split across the thread pool.
+     */
+    template <typename Fn>
+    void ParallelEach(ThreadPool &pool, Fn &&fn) const
+    {
+        ParallelFor(pool, mDense.size(), [&](std::size_t begin, std::size_t end)
+                    {
+            for (std::size_t index = begin; index < end; ++index)
+            {
+                fn(mDense[index]);
+            } });
+    }
+
+    const_iterator begin() const
+    {
+        return mDense.begin();
+    }
+
+    const_iterator end() const
+    {
+        return mDense.end();
+    }
+};
+
+class ECS_EXPORT System
+{
+public:
+    EntitySet mEntities{};
+
+    // Components the system reads and writes in its update, the Scheduler runs
+    // systems whose accesses do not conflict at the same time
+    Signature mReads{};
+    Signature mWrites{};
+    // Set by systems that have to run on the main thread, e.g. because they call into raylib
+    bool mMainThreadOnly = false;
+    // Change tick up to which the system has handled changes, see BasicCoordinator::AdvanceChangeTick
+    std::uint64_t mChangesSeen = 0;
+
+protected:
+    template <typename... Ts>
+    void Reads()
+    {
+        (mReads.set(ComponentTypeOf<Ts>()), ...);
+    }
+
+    template <typename... Ts>
+    void Writes()
+    {
+        (mWrites.set(ComponentTypeOf<Ts>()), ...);
+    }
+};
+
+class ECS_EXPORT SystemManager
+{
+private:
+    // System members are allocated from it
+    std::pmr::memory_resource *mResource;
+    // Systems and their signatures, both indexed by the system's type ID
+    std::vector<std::shared_ptr<System>> mSystems{};
+    std::vector<Signature> mSignatures{};
+    // System type IDs in registration order, snapshots save systems by their index in it since
+    // type IDs follow the first use of each system type in the process
+    std::vector<std::size_t> mRegistrationOrder{};
+    // For each component type, the systems whose signature includes it. Systems with an
+    // empty signature match every entity, so they are listed under every component type.
+    std::array<std::vector<std::size_t>, MAX_COMPONENTS> mSystemsByComponent{};
+
+    template <typename T>
+    std::size_t GetSystemType()
+    {
+        return TypeId<System>::Get<T>();
+    }
+
+    void RebuildSystemsByComponent()
+    {
+        for (auto &systems : mSystemsByComponent)
+        {
+            systems.clear();
+        }
+
+        for (std::size_t type = 0; type < mSystems.size(); ++type)
+        {
+            if (mSystems[type] == nullptr)
+            {
+                continue;
+            }
+
+            for (ComponentType component = 0; component < MAX_COMPONENTS; ++component)
+            {
+                if (mSignatures[type].test(component) || mSignatures[type].none())
+                {
+                    mSystemsByComponent[component].push_back(type);
+                }
+            }
+        }
+    }
+
+    void UpdateMembership(std::size_t type, Entity entity, Signature signature)
+    {
+        auto const &systemSignature = mSignatures[type];
+
+        if ((signature & systemSignature) == systemSignature)
+        {
+            mSystems[type]->mEntities.Insert(entity);
+        }
+        else
+        {
+            mSystems[type]->mEntities.Erase(entity);
+        }
+    }
+
+public:
+    explicit SystemManager(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : mResource(resource)
+    {
+    }
+
+    /**
+     * @brief Hands the members of every system back to the resource, systems can outlive their world.
+     */
+    ~SystemManager()
+    {
+        for (auto &system : mSystems)
+        {
+            if (system != nullptr)
+            {
+                system->mEntities.Reset(std::pmr::get_default_resource());
+            }
+        }
+    }
+
+    SystemManager(const SystemManager &) = delete;
+    SystemManager &operator=(const SystemManager &) = delete;
+
+    template <typename T>
+    std::shared_ptr<T> RegisterSystem()
+    {
+        std::size_t type = GetSystemType<T>();
+
+        if (type >= mSystems.size())
+        {
+            mSystems.resize(type + 1);
+            mSignatures.resize(type + 1);
+        }
+
+        assert(mSystems[type] == nullptr && "Registering system more than once.");
+
+        auto system = std::make_shared<T>();
+        system->mEntities.Reset(mResource);
+        mSystems[type] = system;
+        mRegistrationOrder.push_back(type);
+        RebuildSystemsByComponent();
+
+        return system;
+    }
+
+    template <typename T>
+    void SetSignature(Signature signature)
+    {
+        std::size_t type = GetSystemType<T>();
+
+        assert(type < mSystems.size() && mSystems[type] != nullptr && "System used before registered.");
+
+        mSignatures[type] = signature;
+        RebuildSystemsByComponent();
+    }
+
+    /**
+     * @brief Removes the entity from every system it could be a member of, given its last signature.
+     */
+    void EntityDestroyed(Entity entity, Signature signature)
+    {
+        for (std::size_t type = 0; type < mSystems.size(); ++type)
+        {
+            if (mSystems[type] != nullptr && (signature & mSignatures[type]) == mSignatures[type])
+            {
+                mSystems[type]->mEntities.Erase(entity);
+            }
+        }
+    }
+
+    /**
+     * @brief Updates membership after a single component was added to or removed from the entity.
+     *
+     * Only the systems whose signature includes the changed component are visited.
+     */
+    void EntitySignatureChanged(Entity entity, Signature newSignature, ComponentType changedType)
+    {
+        PROFILE_SCOPE("EntitySignatureChanged");
+
+        for (std::size_t type : mSystemsByComponent[changedType])
+        {
+            UpdateMembership(type, entity, newSignature);
+        }
+    }
+
+    /**
+     * @brief Adds freshly created entities that all share the same signature to the matching systems.
+     */
+    void EntitiesCreated(const Entity *entities, std::size_t count, Signature signature)
+    {
+        for (std::size_t type = 0; type < mSystems.size(); ++type)
+        {
+            if (mSystems[type] == nullptr || (signature & mSignatures[type]) != mSignatures[type])
+            {
+                continue;
+            }
+
+            auto &members = mSystems[type]->mEntities;
+            members.Reserve(members.Size() + count);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                members.Insert(entities[i]);
+            }
+        }
+    }
+
+    /**
+     * @brief Updates membership after any number of components changed at once.
+     *
+     * Only the systems whose signature includes one of the changed components are visited.
+     */
+    void EntitySignatureReplaced(Entity entity, Signature oldSignature, Signature newSignature)
+    {
+        Signature changed = oldSignature ^ newSignature;
+
+        for (std::size_t type = 0; type < mSystems.size(); ++type)
+        {
+            if (mSystems[type] != nullptr && ((mSignatures[type] & changed).any() || mSignatures[type].none()))
+            {
+                UpdateMembership(type, entity, newSignature);
+            }
+        }
+    }
+
+    /**
+     * @brief Updates membership of every system after an arbitrary signature change.
+     */
+    void EntitySignatureChanged(Entity entity, Signature newSignature)
+    {
+        PROFILE_SCOPE("EntitySignatureChanged");
+
+        for (std::size_t type = 0; type < mSystems.size(); ++type)
+        {
+            if (mSystems[type] != nullptr)
+            {
+                UpdateMembership(type, entity, newSignature);
+            }
+        }
+    }
+
+    /**
+     * @brief Writes the entities of every system in registration order, each in its iteration order.
+     */
+    void Save(SnapshotWriter &writer) const
+    {
+        writer.WriteValue(std::uint32_t(mRegistrationOrder.size()));
+
+        for (std::size_t type : mRegistrationOrder)
+        {
+            const EntitySet &members = mSystems[type]->mEntities;
+            writer.WriteValue(std::uint64_t(members.Size()));
+            writer.Write(members.Data(), members.Size() * sizeof(Entity));
+        }
+    }
+
+    /**
+     * @brief Reads the system members written by Save and checks them against the saved signatures.
+     */
+    bool Check(SnapshotReader &reader, const ComponentRegistry &registry, SnapshotEntities &entities) const
+    {
+        auto count = reader.ReadValue<std::uint32_t>();
+        if (reader.Failed() || count != mRegistrationOrder.size())
+        {
+            return false;
+        }
+
+        for (std::size_t type : mRegistrationOrder)
+        {
+            auto size = reader.ReadValue<std::uint64_t>();
+            if (reader.Failed() || size > entities.idCount || size > reader.Remaining() / sizeof(Entity))
+            {
+                return false;
+            }
+
+            auto *members = reinterpret_cast<const Entity *>(reader.Read(std::size_t(size) * sizeof(Entity)));
+            std::uint32_t required = registry.SaveSignature(mSignatures[type]);
+            entities.ClearSeen();
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                if (!entities.See(members[i]) || (entities.signatures[members[i]] & required) != required)
+                {
+                    return false;
+                }
+            }
+
+            // Every entity with the system's components is a member, so none may be missing. A
+            // system with an empty signature follows signature changes instead, it is not counted.
+            if (required != 0)
+            {
+                std::uint64_t matching = 0;
+                for (Entity entity = 0; entity < entities.idCount; ++entity)
+                {
+                    matching += (entities.signatures[entity] & required) == required;
+                }
+
+                if (matching != size)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Restores the entities of every system, the same systems must be registered in the same order.
+     */
+    void Load(SnapshotReader &reader)
+    {
+        reader.ReadValue<std::uint32_t>();
+        for (std::size_t type : mRegistrationOrder)
+        {
+            auto size = std::size_t(reader.ReadValue<std::uint64_t>());
+            auto *members = reinterpret_cast<const Entity *>(reader.Read(size * sizeof(Entity)));
+            mSystems[type]->mEntities.Assign(members, size);
+        }
+    }
+};
+
+/**
+ * @brief Change versions of one component type, for iterating only the entities touched since a tick.
+ *
+ * Every entity has the tick of its last change, and so does every block of 64 entities and
+ * every page of 4096, as the highest tick of the entities below it. Each skips the pages and
+ * blocks that have not changed since the given tick, so its cost follows the number of
+ * changes rather than the number of entities.
+ */
+class ECS_EXPORT ChangeSet
+{
+private:
+    static constexpr std::size_t PAGE_SIZE = 4096;
+    static constexpr std::size_t BLOCK_SIZE = 64;
+    static constexpr std::size_t BLOCKS_PER_PAGE = PAGE_SIZE / BLOCK_SIZE;
+
+    using Version = std::atomic<std::uint64_t>;
+
+    PagedArray<Version, PAGE_SIZE> mEntities;
+    // One page of block versions per page of entities
+    PagedArray<Version, BLOCKS_PER_PAGE> mBlocks;
+    PagedArray<Version, BLOCKS_PER_PAGE> mPages;
+
+    static void Raise(Version &version, std::uint64_t tick)
+    {
+        std::uint64_t current = version.load(std::memory_order_relaxed);
+        while (current < tick && !version.compare_exchange_weak(current, tick, std::memory_order_relaxed))
+        {
+        }
+    }
+
+public:
+    explicit ChangeSet(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : mEntities(resource), mBlocks(resource), mPages(resource)
+    {
+    }
+
+    /**
+     * @brief Allocates the versions of the entity's page, before the entity is first marked.
+     *
+     * Not thread-safe, it is called by structural changes.
+     */
+    void Ensure(Entity entity)
+    {
+        std::size_t page = mEntities.PageOf(entity);
+        mEntities.EnsurePage(page);
+        mBlocks.EnsurePage(page);
+        mPages.EnsurePage(mPages.PageOf(page));
+    }
+
+    /**
+     * @brief Records a change of the entity at the tick, safe from several threads at once.
+     */
+    void Mark(Entity entity, std::uint64_t tick)
+    {
+        mEntities[entity].store(tick, std::memory_order_relaxed);
+        Raise(mBlocks[entity / BLOCK_SIZE], tick);
+        Raise(mPages[entity / PAGE_SIZE], tick);
+    }
+
+    /**
+     * @brief Forgets every change, the pages stay allocated for the next marks.
+     */
+    void Clear()
+    {
+        std::size_t pages = mEntities.Capacity() / PAGE_SIZE;
+        for (std::size_t page = 0; page < pages; ++page)
+        {
+            if (!mEntities.HasPage(page))
+            {
+                continue;
+            }
+
+            for (std::size_t entity = page * PAGE_SIZE; entity < (page + 1) * PAGE_SIZE; ++entity)
+            {
+                mEntities[entity].store(0, std::memory_order_relaxed);
+            }
+            for (std::size_t block = page * BLOCKS_PER_PAGE; block < (page + 1) * BLOCKS_PER_PAGE; ++block)
+            {
+                mBlocks[block].store(0, std::memory_order_relaxed);
+            }
+            mPages[page].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Calls fn(entity) for every entity marked after the given tick, in ID order.
+     */
+    template <typename Fn>
+    void Each(std::uint64_t since, Fn &&fn) const
+    {
+        std::size_t pages = mEntities.Capacity() / PAGE_SIZE;
+        for (std::size_t page = 0; page < pages; ++page)
+        {
+            if (!mEntities.HasPage(page) || mPages[page].load(std::memory_order_relaxed) <= since)
+            {
+                continue;
+            }
+
+            for (std::size_t block = page * BLOCKS_PER_PAGE; block < (page + 1) * BLOCKS_PER_PAGE; ++block)
+            {
+                if (mBlocks[block].load(std::memory_order_relaxed) <= since)
+                {
+                    continue;
+                }
+
+                for (std::size_t entity = block * BLOCK_SIZE; entity < (block + 1) * BLOCK_SIZE; ++entity)
+                {
+                    if (mEntities[entity].load(std::memory_order_relaxed) > since)
+                    {
+                        fn(static_cast<Entity>(entity));
+                    }
+                }
+            }
+        }
+    }
+};
+
+/**
+ * @brief Added, changed and removed versions of every component type, see BasicCoordinator::EachChanged.
+ */
+struct ECS_EXPORT ChangeTracker
+{
+    // Indexed by ComponentType
+    std::pmr::vector<ChangeSet> added;
+    std::pmr::vector<ChangeSet> changed;
+    std::pmr::vector<ChangeSet> removed;
+
+    explicit ChangeTracker(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : added(resource), changed(resource), removed(resource)
+    {
+        for (auto *sets : {&added, &changed, &removed})
+        {
+            sets->reserve(MAX_COMPONENTS);
+            for (std::size_t type = 0; type < MAX_COMPONENTS; ++type)
+            {
+                sets->emplace_back(resource);
+            }
+        }
+    }
+
+    // Forgets every change, keeping the pages
+    void Clear()
+    {
+        for (auto *sets : {&added, &changed, &removed})
+        {
+            for (ChangeSet &set : *sets)
+            {
+                set.Clear();
+            }
+        }
+    }
+
+    void Ensure(Entity entity, ComponentType type)
+    {
+        added[type].Ensure(entity);
+        changed[type].Ensure(entity);
+        removed[type].Ensure(entity);
+    }
+
+    // Adding a component also counts as changing it
+    void MarkAdded(Entity entity, ComponentType type, std::uint64_t tick)
+    {
+        Ensure(entity, type);
+        added[type].Mark(entity, tick);
+        changed[type].Mark(entity, tick);
+    }
+
+    void MarkRemoved(Entity entity, Signature signature, std::uint64_t tick)
+    {
+        for (std::size_t type = 0; type < MAX_COMPONENTS; ++type)
+        {
+            if (signature.test(type))
+            {
+                removed[type].Mark(entity, tick);
+            }
+        }
+    }
+};
+
+/**
+ * @brief Records structural changes to apply later, see BasicCoordinator::FlushCommands.
+ *
+ * Recording never touches the world, so it is safe while systems iterate and, with one
+ * buffer per thread (BasicCoordinator::Commands), from worker threads. Entities created
+ * through a buffer get a provisional handle that is only valid in commands recorded into
+ * the same buffer, it is replaced by a real entity when the buffer is flushed.
+ */
+template <typename Storage>
+class CommandBuffer
+{
+public:
+    // Provisional handles have this bit set, the low bits count creations in the buffer
+    static constexpr Entity PROVISIONAL_ENTITY = Entity{1} << 31;
+    static_assert(MAX_ENTITIES < PROVISIONAL_ENTITY, "Real entity IDs would look provisional.");
+
+private:
+    enum class CommandType : std::uint8_t
+    {
+        DestroyEntity,
+        AddComponent,
+        RemoveComponent
+    };
+
+    struct Command
+    {
+        Entity entity;
+        CommandType type;
+        ComponentType componentType;
+        // Recorded component for AddComponent, lives in mBlocks
+        void *payload;
+        void (*add)(Storage &storage, Entity entity, void *payload);
+        void (*remove)(Storage &storage, Entity entity);
+        void (*destroy)(void *payload);
+    };
+
+    static constexpr std::size_t BLOCK_SIZE = 4096;
+
+    std::vector<Command> mCommands{};
+    Entity mCreatedCount = 0;
+
+    // Component payloads are bump allocated in fixed blocks, so recorded components never move
+    std::vector<std::unique_ptr<std::byte[]>> mBlocks{};
+    std::size_t mCurrentBlock = 0;
+    std::size_t mBlockOffset = 0;
+    std::vector<std::unique_ptr<std::byte[]>> mLargeBlocks{};
+
+    template <typename S>
+    friend class BasicCoordinator;
+
+    void *Allocate(std::size_t size, std::size_t alignment)
+    {
+        assert(alignment <= alignof(std::max_align_t) && "Over-aligned components can not be recorded.");
+
+        // Components larger than a block get an allocation of their own, released by Clear
+        if (size > BLOCK_SIZE)
+        {
+            mLargeBlocks.push_back(std::make_unique<std::byte[]>(size));
+            return mLargeBlocks.back().get();
+        }
+
+        mBlockOffset = (mBlockOffset + alignment - 1) / alignment * alignment;
+        if (mCurrentBlock == mBlocks.size() || mBlockOffset + size > BLOCK_SIZE)
+        {
+            if (mCurrentBlock < mBlocks.size())
+            {
+                ++mCurrentBlock;
+            }
+            if (mCurrentBlock == mBlocks.size())
+            {
+                mBlocks.push_back(std::make_unique<std::byte[]>(BLOCK_SIZE));
+            }
+            mBlockOffset = 0;
+        }
+
+        void *memory = mBlocks[mCurrentBlock].get() + mBlockOffset;
+        mBlockOffset += size;
+
+        return memory;
+    }
+
+public:
+    CommandBuffer() = default;
+    CommandBuffer(const CommandBuffer &) = delete;
+    CommandBuffer &operator=(const CommandBuffer &) = delete;
+
+    ~CommandBuffer()
+    {
+        Clear();
+    }
+
+    static bool IsProvisional(Entity entity)
+    {
+        return (entity & PROVISIONAL_ENTITY) != 0;
+    }
+
+    /**
+     * @brief Records the creation of an entity.
+     *
+     * @return A provisional handle to use in later commands of this buffer.
+     */
+    Entity CreateEntity()
+    {
+        assert(mCreatedCount < PROVISIONAL_ENTITY && "Too many entities created in one buffer.");
+
+        return PROVISIONAL_ENTITY | mCreatedCount++;
+    }
+
+    void DestroyEntity(Entity entity)
+    {
+        mCommands.push_back(Command{entity, CommandType::DestroyEntity, 0, nullptr, nullptr, nullptr, nullptr});
+    }
+
+    template <typename T>
+    void AddComponent(Entity entity, T component)
+    {
+        void *payload = new (Allocate(sizeof(T), alignof(T))) T(std::move(component));
+
+        mCommands.push_back(Command{
+            entity, CommandType::AddComponent, ComponentTypeOf<T>(), payload,
+            [](Storage &storage, Entity target, void *recorded)
+            { storage.template AddComponent<T>(target, std::move(*static_cast<T *>(recorded))); },
+            nullptr,
+            [](void *recorded)
+            { static_cast<T *>(recorded)->~T(); }});
+    }
+
+    template <typename T>
+    void RemoveComponent(Entity entity)
+    {
+        mCommands.push_back(Command{
+            entity, CommandType::RemoveComponent, ComponentTypeOf<T>(), nullptr,
+            nullptr,
+            [](Storage &storage, Entity target)
+            { storage.template RemoveComponent<T>(target); },
+            nullptr});
+    }
+
+    bool Empty() const
+    {
+        return mCommands.empty() && mCreatedCount == 0;
+    }
+
+    /**
+     * @brief Drops every recorded command, keeping the payload blocks for reuse.
+     */
+    void Clear()
+    {
+        for (Command &command : mCommands)
+        {
+            if (command.destroy != nullptr)
+            {
+                command.destroy(command.payload);
+            }
+        }
+
+        mCommands.clear();
+        mCreatedCount = 0;
+        mCurrentBlock = 0;
+        mBlockOffset = 0;
+        mLargeBlocks.clear();
+    }
+};
+
+/**
+ * @brief Iterates the entities that have every component in Ts, see BasicCoordinator::View.
+ *
+ * Structural changes (adding or removing components, destroying entities) while
+ * iterating are not supported.
+ */
+template <typename Storage, typename... Ts>
+class ComponentView
+{
+private:
+    Storage &mStorage;
+    const EntityManager &mEntityManager;
+    Signature mInclude{};
+    Signature mExclude{};
+
+public:
+    ComponentView(Storage &storage, const EntityManager &entityManager)
+        : mStorage(storage), mEntityManager(entityManager)
+    {
+        (mInclude.set(ComponentTypeOf<Ts>()), ...);
+    }
+
+    /**
+     * @brief Skips entities that have any of the given components.
+     */
+    template <typename... Excluded>
+    ComponentView &Exclude()
+    {
+        (mExclude.set(ComponentTypeOf<Excluded>()), ...);
+        return *this;
+    }
+
+    /**
+     * @brief Calls fn(Entity, Ts &...) for every matching entity.
+     */
+    template <typename Fn>
+    void Each(Fn &&fn)
+    {
+        mStorage.template Each<Ts...>(mInclude, mExclude, mEntityManager, std::forward<Fn>(fn));
+    }
+
+    /**
+     * @brief Each, split into chunks that run across the thread pool's workers.
+     *
+     * fn is called concurrently for different entities. It may write the components it is
+     * given, each entity is visited by exactly one thread, but must not make structural changes.
+     */
+    template <typename Fn>
+    void ParallelEach(ThreadPool &pool, Fn &&fn)
     {
-        for (Entity entity = 0; entity < MAX_ENTITIES; ++entity)
-        {
-            mAvailableEntities.push(entity);
-        }
+        mStorage.template ParallelEach<Ts...>(mInclude, mExclude, mEntityManager, pool, std::forward<Fn>(fn));
     }
+};
 
-    Entity CreateEntity()
+/**
+ * @brief Front door to the ECS, ties entities, component storage and systems together.
+ *
+ * @tparam Storage The component storage backend, ComponentManager (one pool per component
+ * type) or ArchetypeManager (chunks shared by entities with the same signature).
+ * Both expose the same interface, so systems do not depend on the choice.
+ */
+template <typename Storage>
+class BasicCoordinator
+{
+private:
+    // Declared first so it outlives everything allocated from it
+    WorldMemory mMemory;
+    ResourcePtr<Storage> mComponentManager;
+    ResourcePtr<EntityManager> mEntityManager;
+    ResourcePtr<SystemManager> mSystemManager;
+    ResourcePtr<ChangeTracker> mChangeTracker;
+    // Tick that changes are marked with, see AdvanceChangeTick
+    std::atomic<std::uint64_t> mChangeTick{1};
+
+    // One command buffer per recording thread, see Commands()
+    std::vector<std::unique_ptr<CommandBuffer<Storage>>> mCommandBuffers{};
+    std::unordered_map<std::thread::id, CommandBuffer<Storage> *> mCommandBuffersByThread{};
+    std::mutex mCommandBuffersMutex;
+    // Tells a thread's cached buffer apart from one of a previous Init or another coordinator
+    std::uint64_t mInstance = 0;
+
+    static std::uint64_t NextInstance()
     {
-        assert(mLivingEntityCount < MAX_ENTITIES && "Too many entities in existence.");
+        static std::atomic<std::uint64_t> next{1};
+        return next++;
+    }
 
-        Entity entity = mAvailableEntities.front();
-        mAvailableEntities.pop();
-        ++mLivingEntityCount;
+    template <typename Fn>
+    void EachMarked(const ChangeSet &changes, ComponentType type, std::uint64_t since, Fn &&fn)
+    {
+        changes.Each(since, [&](Entity entity)
+                     {
+            if (mEntityManager->GetSignature(entity).test(type))
+            {
+                fn(entity);
+            } });
+    }
 
-        return entity;
+    // Reads the header written by SaveSnapshot, false if it does not match this coordinator
+    bool ReadSnapshotHeader(SnapshotReader &reader) const
+    {
+        return reader.ReadValue<std::uint32_t>() == SNAPSHOT_MAGIC && reader.ReadValue<std::uint32_t>() == SNAPSHOT_VERSION &&
+               reader.ReadValue<std::uint32_t>() == Storage::SNAPSHOT_STORAGE && mComponentManager->GetRegistry().Matches(reader) &&
+               !reader.Failed();
     }
 
-    void DestroyEntity(Entity entity)
+public:
+    /**
+     * @brief Starts an empty world, the previous one is torn down and its memory released at once.
+     *
+     * @param entityCapacityHint Number of entities to allocate room for up front,
+     * storage still grows past it on demand.
+     * @param upstream Where the world's memory comes from, see WorldMemory.
+     */
+    void Init(std::size_t entityCapacityHint = 0, std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
     {
-        assert(entity < MAX_ENTITIES && "Entity out of range.");
+        // Everything pointing into the old world's memory goes before it is released
+        mSystemManager.reset();
+        mChangeTracker.reset();
+        mComponentManager.reset();
+        mEntityManager.reset();
+        mMemory.Reset(upstream);
 
-        // Invalidate the destroyed entity's signature
-        mSignatures[entity].reset();
+        // Create pointers to each manager
+        std::pmr::memory_resource *resource = mMemory.Resource();
+        mComponentManager = MakeResourcePtr<Storage>(resource, resource);
+        mEntityManager = MakeResourcePtr<EntityManager>(resource, resource);
+        mSystemManager = MakeResourcePtr<SystemManager>(resource, resource);
+        mChangeTracker = MakeResourcePtr<ChangeTracker>(resource, resource);
+        mChangeTick = 1;
+
+        mEntityManager->Reserve(entityCapacityHint);
+
+        mCommandBuffers.clear();
+        mCommandBuffersByThread.clear();
+        mInstance = NextInstance();
+    }
 
-        mAvailableEntities.push(entity);
-        --mLivingEntityCount;
+    // Entity methods
+    Entity CreateEntity()
+    {
+        return mEntityManager->CreateEntity();
     }
 
-    void SetSignature(Entity entity, Signature signature)
+    void DestroyEntity(Entity entity)
     {
-        assert(entity < MAX_ENTITIES && "Entity is out of range.");
+        PROFILE_SCOPE("DestroyEntity");
 
-        mSignatures[entity] = signature;
+        auto signature = mEntityManager->GetSignature(entity);
+        mEntityManager->DestroyEntity(entity);
+
+        mComponentManager->EntityDestroyed(entity, signature);
+        mChangeTracker->MarkRemoved(entity, signature, GetChangeTick());
+
+        mSystemManager->EntityDestroyed(entity, signature);
     }
 
-    Signature GetSignature(Entity entity)
+    std::uint32_t GetLivingEntityCount() const
     {
-        assert(entity < MAX_ENTITIES && "Entity is out of range.");
-
-        return mSignatures[entity];
+        return mEntityManager->GetLivingEntityCount();
     }
-};
 
-class ECS_EXPORT IComponentArray
-{
-public:
-    virtual ~IComponentArray() = default;
-    virtual void EntityDestroyed(Entity entity) = 0;
-};
+    // Snapshot methods
+    static constexpr std::uint32_t SNAPSHOT_MAGIC = 0x4e535154; // "TQSN"
+    static constexpr std::uint32_t SNAPSHOT_VERSION = 3;
 
-template <typename T>
-class ECS_EXPORT ComponentArray : public IComponentArray
-{
-private:
-    // The dense array of components, it is also called packed array
-    // because it is a contiguous block of memory
-    // meaning that the components are stored next to each other in memory
-    // and there are no gaps between them.
-    std::array<T, MAX_ENTITIES> mComponentArray;
-    // Map from an entity ID to an array index.
-    std::unordered_map<Entity, std::size_t> mEntityToIndexMap;
-    // Map from an array index to an entity ID.
-    std::unordered_map<std::size_t, Entity> mIndexToEntityMap;
+    /**
+     * @brief Reads a whole snapshot without loading it, and tells whether LoadSnapshot can take it.
+     *
+     * Every count is checked against the bytes left before its block is read, and every entity
+     * listed by a pool, archetype or system against the saved signatures, so a truncated or
+     * corrupt snapshot is turned down before the world is touched.
+     */
+    bool CheckSnapshot(const std::byte *data, std::size_t size) const
+    {
+        SnapshotReader reader(data, size);
+        SnapshotEntities entities;
+        const ComponentRegistry &registry = mComponentManager->GetRegistry();
 
-    // Total size of valid entries in the array.
-    std::size_t mSize{};
+        return ReadSnapshotHeader(reader) && EntityManager::Check(reader, registry, entities) &&
+               mComponentManager->Check(reader, entities) && mSystemManager->Check(reader, registry, entities) &&
+               reader.Remaining() == 0;
+    }
 
-public:
     /**
-     * @brief Inserts the component at the end of the array, and updates the maps.
+     * @brief Saves the entities, signatures, component pools and system members into the buffer.
      *
-     * @param entity The entity ID to associate with the component.
-     * @param component The component to add to the array.
+     * The buffer is cleared first and its capacity reused, components are copied as raw
+     * blocks so they must be trivially copyable. Call it between frames, after FlushCommands.
      *
-     * @note This method will assert if the entity already has a component in the array.
+     * @return false, with the buffer left empty, if a registered component is not trivially copyable.
      */
-    void InsertData(Entity entity, T component)
+    bool SaveSnapshot(std::vector<std::byte> &buffer) const
     {
-        assert(mEntityToIndexMap.find(entity) == mEntityToIndexMap.end() && "Component added to same entity more than once.");
+        buffer.clear();
+        if (!mComponentManager->CanSnapshot())
+        {
+            return false;
+        }
 
-        std::size_t newIndex = mSize;
-        mEntityToIndexMap[entity] = newIndex;
-        mIndexToEntityMap[newIndex] = entity;
-        mComponentArray[newIndex] = component;
-        ++mSize;
+        SnapshotWriter writer(buffer);
+
+        writer.WriteValue(SNAPSHOT_MAGIC);
+        writer.WriteValue(SNAPSHOT_VERSION);
+        writer.WriteValue(Storage::SNAPSHOT_STORAGE);
+        mComponentManager->GetRegistry().Save(writer);
+
+        mEntityManager->Save(writer, mComponentManager->GetRegistry());
+        mComponentManager->Save(writer);
+        mSystemManager->Save(writer);
+        return true;
     }
 
     /**
-     * @brief Removes a component from the array, and updates the maps.
+     * @brief Replaces the world with a snapshot, for example one mapped with MappedSnapshot.
      *
-     * @param entity The entity ID to remove from the array.
+     * The coordinator must register the same components and systems as the one that saved the
+     * snapshot, in the same order: both are saved by registration index rather than by their
+     * type IDs, which depend on the order types are first used in the process.
      *
-     * The remove process will swap the last element with the element to remove,
-     * and update the maps to point to the new location of the moved element.
+     * The whole snapshot is checked first, see CheckSnapshot, so when it is turned down the
+     * world is left as it was.
      *
-     * @note This method will assert if the entity does not have a component in the array.
+     * @return false if the data is not a snapshot of this version and storage, if its components
+     * differ in number, size or alignment from the registered ones, if it is truncated or
+     * corrupt, or if a registered component is not trivially copyable.
      */
-    void RemoveData(Entity entity)
+    bool LoadSnapshot(const std::byte *data, std::size_t size)
     {
-        assert(mEntityToIndexMap.find(entity) != mEntityToIndexMap.end() && "Removing non-existent component.");
-
-        // First find the index of the component that will be removed
-        std::size_t indexOfRemovedEntity = mEntityToIndexMap[entity];
-        std::size_t indexOfLastElement = mSize - 1;
-        // Now swap the last element with the element to remove
-        mComponentArray[indexOfRemovedEntity] = mComponentArray[indexOfLastElement];
+        if (!mComponentManager->CanSnapshot() || !CheckSnapshot(data, size))
+        {
+            return false;
+        }
 
-        // Next update the maps to point to the new locations
-        Entity entityOfLastElement = mIndexToEntityMap[indexOfLastElement];
-        mEntityToIndexMap[entityOfLastElement] = indexOfRemovedEntity;
-        mIndexToEntityMap[indexOfRemovedEntity] = entityOfLastElement;
+        // The managers are refilled in place, so loading again and again reuses their storage
+        SnapshotReader reader(data, size);
+        ReadSnapshotHeader(reader);
+        mEntityManager->Load(reader, mComponentManager->GetRegistry());
+        mComponentManager->Load(reader);
+        mSystemManager->Load(reader);
+
+        // Every loaded component counts as added, so systems catch up on the whole world
+        mChangeTracker->Clear();
+        std::uint64_t tick = GetChangeTick();
+        for (Entity entity = 0; entity < mEntityManager->GetIdCount(); ++entity)
+        {
+            Signature signature = mEntityManager->GetSignature(entity);
+            for (std::size_t type = 0; type < MAX_COMPONENTS; ++type)
+            {
+                if (signature.test(type))
+                {
+                    mChangeTracker->MarkAdded(entity, ComponentType(type), tick);
+                }
+            }
+        }
 
-        // Finally remove the entity, remove the index map, and reduce the size
-        mEntityToIndexMap.erase(entity);
-        mIndexToEntityMap.erase(indexOfLastElement);
-        --mSize;
+        return true;
     }
 
-    T &GetData(Entity entity)
+    bool LoadSnapshot(const std::vector<std::byte> &snapshot)
     {
-        assert(mEntityToIndexMap.find(entity) != mEntityToIndexMap.end() && "Retrieving non-existent component.");
-        std::size_t indexOfEntity = mEntityToIndexMap[entity];
-
-        return mComponentArray[indexOfEntity];
+        return LoadSnapshot(snapshot.data(), snapshot.size());
     }
 
-    void EntityDestroyed(Entity entity) override
+    /**
+     * @brief Creates count entities that each get a copy of the given components.
+     *
+     * Pools are reserved once, components are written in one pass per type, and the
+     * shared signature is propagated to the systems in one pass.
+     *
+     * @return The new entities, in creation order.
+     */
+    template <typename... Ts>
+    std::vector<Entity> CreateEntities(std::size_t count, const Ts &...components)
     {
-        if (mEntityToIndexMap.find(entity) != mEntityToIndexMap.end())
+        std::vector<Entity> entities(count);
+        for (Entity &entity : entities)
         {
-            RemoveData(entity);
+            entity = mEntityManager->CreateEntity();
         }
-    }
-};
 
-class ECS_EXPORT ComponentManager
-{
-private:
-    std::unordered_map<const char *, ComponentType> mComponentTypes{};
-    std::unordered_map<const char *, std::shared_ptr<IComponentArray>> mComponentArrays{};
-    ComponentType mNextComponentType{};
+        if constexpr (sizeof...(Ts) > 0)
+        {
+            mComponentManager->InsertEntities(entities.data(), count, components...);
 
-    template <typename T>
-    std::shared_ptr<ComponentArray<T>> GetComponentArray()
-    {
-        const char *typeName = typeid(T).name();
+            Signature signature;
+            (signature.set(GetComponentType<Ts>()), ...);
+            std::uint64_t tick = GetChangeTick();
+            for (Entity entity : entities)
+            {
+                mEntityManager->SetSignature(entity, signature);
+                (mChangeTracker->MarkAdded(entity, GetComponentType<Ts>(), tick), ...);
+            }
 
-        assert(mComponentTypes.find(typeName) != mComponentTypes.end() && "Component not registered before use.");
+            mSystemManager->EntitiesCreated(entities.data(), count, signature);
+        }
 
-        return std::static_pointer_cast<ComponentArray<T>>(mComponentArrays[typeName]);
+        return entities;
     }
 
-public:
+    // Component methods
     template <typename T>
-    void RegisterComponent()
+    void RegisterComponent(std::size_t capacityHint = 0)
     {
-        const char *typeName = typeid(T).name();
+        mComponentManager->template RegisterComponent<T>(capacityHint);
+    }
 
-        assert(mComponentTypes.find(typeName) == mComponentTypes.end() && "Registering component type more than once.");
+    template <typename T>
+    void AddComponent(Entity entity, T component)
+    {
+        PROFILE_SCOPE("AddComponent");
 
-        // Add this component type to the component type map
-        mComponentTypes.insert({typeName, mNextComponentType});
+        mComponentManager->template AddComponent<T>(entity, component);
 
-        // Create a ComponentArray pointer and add it to the component arrays map
-        mComponentArrays.insert({typeName, std::make_shared<ComponentArray<T>>()});
+        auto type = mComponentManager->template GetComponentType<T>();
+        auto signature = mEntityManager->GetSignature(entity);
+        signature.set(type, true);
+        mEntityManager->SetSignature(entity, signature);
+        mChangeTracker->MarkAdded(entity, type, GetChangeTick());
 
-        // Increment the value so that the next component registered will be different
-        ++mNextComponentType;
+        mSystemManager->EntitySignatureChanged(entity, signature, type);
     }
 
     template <typename T>
-    ComponentType GetComponentType()
+    void RemoveComponent(Entity entity)
     {
-        const char *typeName = typeid(T).name();
+        PROFILE_SCOPE("RemoveComponent");
+
+        mComponentManager->template RemoveComponent<T>(entity);
 
-        assert(mComponentTypes.find(typeName) != mComponentTypes.end() && "Component not registered before use.");
+        auto type = mComponentManager->template GetComponentType<T>();
+        auto signature = mEntityManager->GetSignature(entity);
+        signature.set(type, false);
+        mEntityManager->SetSignature(entity, signature);
+        mChangeTracker->removed[type].Mark(entity, GetChangeTick());
 
-        return mComponentTypes[typeName];
+        mSystemManager->EntitySignatureChanged(entity, signature, type);
     }
 
+    /**
+     * @brief Adds a copy of the component to every entity, reserving pool capacity once.
+     */
     template <typename T>
-    void AddComponent(Entity entity, T component)
+    void AddComponents(const std::vector<Entity> &entities, const T &component)
     {
-        GetComponentArray<T>()->InsertData(entity, component);
+        mComponentManager->AddComponents(entities.data(), entities.size(), component);
+
+        auto type = mComponentManager->template GetComponentType<T>();
+        std::uint64_t tick = GetChangeTick();
+        for (Entity entity : entities)
+        {
+            auto signature = mEntityManager->GetSignature(entity);
+            signature.set(type, true);
+            mEntityManager->SetSignature(entity, signature);
+            mChangeTracker->MarkAdded(entity, type, tick);
+
+            mSystemManager->EntitySignatureChanged(entity, signature, type);
+        }
     }
 
     template <typename T>
-    void RemoveComponent(Entity entity)
+    void RemoveComponents(const std::vector<Entity> &entities)
     {
-        GetComponentArray<T>()->RemoveData(entity);
+        mComponentManager->template RemoveComponents<T>(entities.data(), entities.size());
+
+        auto type = mComponentManager->template GetComponentType<T>();
+        std::uint64_t tick = GetChangeTick();
+        for (Entity entity : entities)
+        {
+            auto signature = mEntityManager->GetSignature(entity);
+            signature.set(type, false);
+            mEntityManager->SetSignature(entity, signature);
+            mChangeTracker->removed[type].Mark(entity, tick);
+
+            mSystemManager->EntitySignatureChanged(entity, signature, type);
+        }
     }
 
+    /**
+     * @brief Mutable access to the entity's component, marks it changed for EachChanged.
+     *
+     * Use ReadComponent for components that are only read, so they do not show up as changed.
+     */
     template <typename T>
     T &GetComponent(Entity entity)
     {
-        return GetComponentArray<T>()->GetData(entity);
+        MarkChanged<T>(entity);
+        return mComponentManager->template GetComponent<T>(entity);
     }
 
-    void EntityDestroyed(Entity entity)
+    template <typename T>
+    const T &ReadComponent(Entity entity)
     {
-        for (auto const &pair : mComponentArrays)
-        {
-            auto const &componentArray = pair.second;
-
-            componentArray->EntityDestroyed(entity);
-        }
+        return mComponentManager->template GetComponent<T>(entity);
     }
-};
-
-class ECS_EXPORT System
-{
-public:
-    std::set<Entity> mEntities{};
-};
-
-class ECS_EXPORT SystemManager
-{
-private:
-    std::unordered_map<const char *, std::shared_ptr<System>> mSystems{};
-    std::unordered_map<const char *, Signature> mSignatures{};
 
-public:
     template <typename T>
-    std::shared_ptr<T> RegisterSystem()
+    ComponentType GetComponentType()
     {
-        const char *typeName = typeid(T).name();
+        return mComponentManager->template GetComponentType<T>();
+    }
 
-        assert(mSystems.find(typeName) == mSystems.end() && "Registering system more than once.");
+    // Change tracking
 
-        auto system = std::make_shared<T>();
-        mSystems.insert({typeName, system});
+    /**
+     * @brief The tick that changes are marked with until the next AdvanceChangeTick.
+     */
+    std::uint64_t GetChangeTick() const
+    {
+        return mChangeTick.load(std::memory_order_relaxed);
+    }
 
-        return system;
+    /**
+     * @brief Starts a new tick and returns the one that ends.
+     *
+     * A system that reacts to changes stores the result in System::mChangesSeen at the end of
+     * its update and passes that to EachChanged on its next update. Its own writes carry the
+     * returned tick, so it does not see them again, while anything written after it has a
+     * later tick. The Scheduler never runs it alongside a writer of what it reads.
+     */
+    std::uint64_t AdvanceChangeTick()
+    {
+        return mChangeTick.fetch_add(1, std::memory_order_relaxed);
     }
 
+    /**
+     * @brief Marks a component as changed, for writes that do not go through GetComponent, e.g. in View::Each.
+     *
+     * Safe to call from several threads at once.
+     */
     template <typename T>
-    void SetSignature(Signature signature)
+    void MarkChanged(Entity entity)
     {
-        const char *typeName = typeid(T).name();
-
-        assert(mSystems.find(typeName) != mSystems.end() && "System used before registered.");
-
-        mSignatures.insert({typeName, signature});
+        mChangeTracker->changed[ComponentTypeOf<T>()].Mark(entity, GetChangeTick());
     }
 
-    void EntityDestroyed(Entity entity)
+    /**
+     * @brief Calls fn(entity) for every entity that still has T and that got T after the tick.
+     */
+    template <typename T, typename Fn>
+    void EachAdded(std::uint64_t since, Fn &&fn)
     {
-        for (auto pair : mSystems)
-        {
-            auto const &system = pair.second;
-
-            system->mEntities.erase(entity);
-        }
+        EachMarked(mChangeTracker->added[ComponentTypeOf<T>()], ComponentTypeOf<T>(), since, std::forward<Fn>(fn));
     }
 
-    void EntitySignatureChanged(Entity entity, Signature newSignature)
+    /**
+     * @brief Calls fn(entity) for every entity that still has T and whose T was added or
+     * written after the tick, in ID order. Each entity is visited once however often it changed.
+     */
+    template <typename T, typename Fn>
+    void EachChanged(std::uint64_t since, Fn &&fn)
     {
-        for (auto pair : mSystems)
-        {
-            auto const &type = pair.first;
-            auto const &system = pair.second;
-            auto const &systemSignature = mSignatures[type];
-
-            if ((newSignature & systemSignature) == systemSignature)
-            {
-                system->mEntities.insert(entity);
-            }
-            else
-            {
-                system->mEntities.erase(entity);
-            }
-        }
+        EachMarked(mChangeTracker->changed[ComponentTypeOf<T>()], ComponentTypeOf<T>(), since, std::forward<Fn>(fn));
     }
-};
-
-class Coordinator
-{
-private:
-    std::unique_ptr<ComponentManager> mComponentManager;
-    std::unique_ptr<EntityManager> mEntityManager;
-    std::unique_ptr<SystemManager> mSystemManager;
 
-public:
-    void Init()
+    /**
+     * @brief Calls fn(entity) for every entity that lost T after the tick, by RemoveComponent
+     * or by being destroyed. The entity may have been destroyed or have T again since.
+     */
+    template <typename T, typename Fn>
+    void EachRemoved(std::uint64_t since, Fn &&fn)
     {
-        // Create pointers to each manager
-        mComponentManager = std::make_unique<ComponentManager>();
-        mEntityManager = std::make_unique<EntityManager>();
-        mSystemManager = std::make_unique<SystemManager>();
+        mChangeTracker->removed[ComponentTypeOf<T>()].Each(since, std::forward<Fn>(fn));
     }
 
-    // Entity methods
-    Entity CreateEntity()
+    /**
+     * @brief View over every entity that has all of the listed components.
+     *
+     * @code
+     * gCoordinator.View<GridCell, BoardPosition>().Each([](Entity entity, GridCell &cell, BoardPosition &position) {});
+     * @endcode
+     *
+     * @note Writes through a view are not tracked, call MarkChanged for the components written.
+     */
+    template <typename... Ts>
+    ComponentView<Storage, Ts...> View()
     {
-        return mEntityManager->CreateEntity();
+        return ComponentView<Storage, Ts...>(*mComponentManager, *mEntityManager);
     }
 
-    void DestroyEntity(Entity entity)
+    // Deferred structural changes
+
+    /**
+     * @brief The calling thread's command buffer, created on first use.
+     *
+     * Changes recorded into it are applied by the next FlushCommands.
+     */
+    CommandBuffer<Storage> &Commands()
     {
-        mEntityManager->DestroyEntity(entity);
+        struct CachedBuffer
+        {
+            std::uint64_t instance = 0;
+            CommandBuffer<Storage> *buffer = nullptr;
+        };
+        static thread_local CachedBuffer tCached;
 
-        mComponentManager->EntityDestroyed(entity);
+        if (tCached.instance == mInstance)
+        {
+            return *tCached.buffer;
+        }
 
-        mSystemManager->EntityDestroyed(entity);
-    }
+        std::lock_guard<std::mutex> lock(mCommandBuffersMutex);
+        auto &buffer = mCommandBuffersByThread[std::this_thread::get_id()];
+        if (buffer == nullptr)
+        {
+            mCommandBuffers.push_back(std::make_unique<CommandBuffer<Storage>>());
+            buffer = mCommandBuffers.back().get();
+        }
+        tCached = CachedBuffer{mInstance, buffer};
 
-    // Component methods
-    template <typename T>
-    void RegisterComponent()
-    {
-        mComponentManager->RegisterComponent<T>();
+        return *buffer;
     }
 
-    template <typename T>
-    void AddComponent(Entity entity, T component)
+    /**
+     * @brief Applies every thread's recorded commands, must be called while no thread records or iterates.
+     *
+     * Provisional entities are created first. The remaining commands are sorted by entity
+     * and applied entity by entity in recording order, so each entity's signature is
+     * written and propagated to the systems once per flush instead of once per command.
+     */
+    void FlushCommands()
     {
-        mComponentManager->AddComponent<T>(entity, component);
+        PROFILE_SCOPE("FlushCommands");
+        std::lock_guard<std::mutex> lock(mCommandBuffersMutex);
 
-        auto signature = mEntityManager->GetSignature(entity);
-        signature.set(mComponentManager->GetComponentType<T>(), true);
-        mEntityManager->SetSignature(entity, signature);
+        struct CommandRef
+        {
+            Entity entity;
+            std::uint32_t buffer;
+            std::uint32_t index;
+        };
+
+        std::vector<std::vector<Entity>> created(mCommandBuffers.size());
+        std::size_t commandCount = 0;
+        for (std::size_t buffer = 0; buffer < mCommandBuffers.size(); ++buffer)
+        {
+            created[buffer].resize(mCommandBuffers[buffer]->mCreatedCount);
+            for (Entity &entity : created[buffer])
+            {
+                entity = mEntityManager->CreateEntity();
+            }
+            commandCount += mCommandBuffers[buffer]->mCommands.size();
+        }
 
-        mSystemManager->EntitySignatureChanged(entity, signature);
-    }
+        std::vector<CommandRef> refs;
+        refs.reserve(commandCount);
+        for (std::size_t buffer = 0; buffer < mCommandBuffers.size(); ++buffer)
+        {
+            auto const &commands = mCommandBuffers[buffer]->mCommands;
+            for (std::size_t index = 0; index < commands.size(); ++index)
+            {
+                Entity entity = commands[index].entity;
+                if (CommandBuffer<Storage>::IsProvisional(entity))
+                {
+                    entity = created[buffer][entity & ~CommandBuffer<Storage>::PROVISIONAL_ENTITY];
+                }
+                refs.push_back(CommandRef{entity, std::uint32_t(buffer), std::uint32_t(index)});
+            }
+        }
 
-    template <typename T>
-    void RemoveComponent(Entity entity)
-    {
-        mComponentManager->RemoveComponent<T>(entity);
+        // Stable, so each entity's commands keep their recording order
+        std::stable_sort(refs.begin(), refs.end(), [](CommandRef const &a, CommandRef const &b)
+                         { return a.entity < b.entity; });
 
-        auto signature = mEntityManager->GetSignature(entity);
-        signature.set(mComponentManager->GetComponentType<T>(), false);
-        mEntityManager->SetSignature(entity, signature);
+        for (std::size_t begin = 0; begin < refs.size();)
+        {
+            Entity entity = refs[begin].entity;
+            Signature oldSignature = mEntityManager->GetSignature(entity);
+            Signature signature = oldSignature;
+            bool destroyed = false;
+            std::uint64_t tick = GetChangeTick();
+
+            std::size_t end = begin;
+            for (; end < refs.size() && refs[end].entity == entity; ++end)
+            {
+                auto const &command = mCommandBuffers[refs[end].buffer]->mCommands[refs[end].index];
+                if (destroyed)
+                {
+                    continue;
+                }
+
+                switch (command.type)
+                {
+                case CommandBuffer<Storage>::CommandType::AddComponent:
+                    command.add(*mComponentManager, entity, command.payload);
+                    signature.set(command.componentType);
+                    mChangeTracker->MarkAdded(entity, command.componentType, tick);
+                    break;
+                case CommandBuffer<Storage>::CommandType::RemoveComponent:
+                    command.remove(*mComponentManager, entity);
+                    signature.reset(command.componentType);
+                    mChangeTracker->removed[command.componentType].Mark(entity, tick);
+                    break;
+                case CommandBuffer<Storage>::CommandType::DestroyEntity:
+                    mEntityManager->DestroyEntity(entity);
+                    mComponentManager->EntityDestroyed(entity, signature);
+                    mChangeTracker->MarkRemoved(entity, signature, tick);
+                    // System membership still reflects the signature from before the flush
+                    mSystemManager->EntityDestroyed(entity, oldSignature);
+                    destroyed = true;
+                    break;
+                }
+            }
 
-        mSystemManager->EntitySignatureChanged(entity, signature);
-    }
+            if (!destroyed)
+            {
+                mEntityManager->SetSignature(entity, signature);
+                mSystemManager->EntitySignatureReplaced(entity, oldSignature, signature);
+            }
 
-    template <typename T>
-    T &GetComponent(Entity entity)
-    {
-        return mComponentManager->GetComponent<T>(entity);
-    }
+            begin = end;
+        }
 
-    template <typename T>
-    ComponentType GetComponentType()
-    {
-        return mComponentManager->GetComponentType<T>();
+        for (auto &buffer : mCommandBuffers)
+        {
+            buffer->Clear();
+        }
     }
 
     // System methods
@@ -394,4 +3464,11 @@ public:
     {
         mSystemManager->SetSignature<T>(signature);
     }
-};
\ No newline at end of file
+};
+
+// Storage backend used by Coordinator, define ECS_ARCHETYPE_STORAGE to switch to archetype chunks
+#ifdef ECS_ARCHETYPE_STORAGE
+using Coordinator = BasicCoordinator<ArchetypeManager>;
+#else
+using Coordinator = BasicCoordinator<ComponentManager>;
+#endif
@@ -0,0 +1,531 @@
+#include "game.h"
+
+#include <cmath>
+#include <cstdio>
+
+Coordinator gCoordinator;
+
+// Move sources
+
+ScriptedMoveSource::ScriptedMoveSource(std::vector<InputEvent> events)
+    : mEvents(events.begin(), events.end())
+{
+}
+
+InputEvent ScriptedMoveSource::Poll(Entity)
+{
+    if (mEvents.empty())
+    {
+        return InputEvent{};
+    }
+
+    InputEvent event = mEvents.front();
+    mEvents.pop_front();
+
+    return event;
+}
+
+// InputLog
+
+namespace
+{
+    constexpr std::uint32_t INPUT_LOG_MAGIC = 0x4e495154; // "TQIN"
+    constexpr std::uint32_t INPUT_LOG_VERSION = 1;
+}
+
+InputLog::InputLog(const BoardRules &rules)
+    : mRules(rules)
+{
+}
+
+void InputLog::Record(std::uint32_t frame, const InputEvent &event)
+{
+    mRecords.push_back(InputRecord{frame, std::uint8_t(event.type), std::uint8_t(event.cell.row), std::uint8_t(event.cell.col), 0});
+}
+
+std::vector<InputEvent> InputLog::Events() const
+{
+    std::vector<InputEvent> events;
+    events.reserve(mRecords.size());
+    for (const auto &record : mRecords)
+    {
+        events.push_back(InputEvent{InputEventType(record.type), BoardPosition{record.row, record.col}});
+    }
+
+    return events;
+}
+
+bool InputLog::Save(const char *path) const
+{
+    std::vector<std::byte> buffer;
+    SnapshotWriter writer(buffer);
+    writer.WriteValue(INPUT_LOG_MAGIC);
+    writer.WriteValue(INPUT_LOG_VERSION);
+    writer.WriteValue(mRules);
+    writer.WriteValue(std::uint64_t(mRecords.size()));
+    writer.Write(mRecords.data(), mRecords.size() * sizeof(InputRecord));
+
+    return SaveSnapshotFile(path, buffer);
+}
+
+bool InputLog::Load(const char *path)
+{
+    MappedSnapshot file;
+    if (!file.Open(path))
+    {
+        return false;
+    }
+
+    // The reader fails rather than reading past the end, so a short file fails the whole header
+    SnapshotReader reader(file.Data(), file.Size());
+    auto magic = reader.ReadValue<std::uint32_t>();
+    auto version = reader.ReadValue<std::uint32_t>();
+    auto rules = reader.ReadValue<BoardRules>();
+    auto count = reader.ReadValue<std::uint64_t>();
+    if (reader.Failed() || magic != INPUT_LOG_MAGIC || version != INPUT_LOG_VERSION || !ValidBoardRules(rules) ||
+        count > reader.Remaining() / sizeof(InputRecord))
+    {
+        return false;
+    }
+
+    auto *records = reinterpret_cast<const InputRecord *>(reader.Read(std::size_t(count) * sizeof(InputRecord)));
+    if (records == nullptr)
+    {
+        return false;
+    }
+
+    // Replays mark every CELL record's position, it has to be on the board
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto type = InputEventType(records[i].type);
+        bool onBoard = records[i].row < rules.height && records[i].col < rules.width;
+        if (type != InputEventType::RESET && (type != InputEventType::CELL || !onBoard))
+        {
+            return false;
+        }
+    }
+
+    mRules = rules;
+    mRecords.assign(records, records + count);
+
+    return true;
+}
+
+RandomMoveSource::RandomMoveSource(std::uint32_t seed)
+    : mRandom(seed)
+{
+}
+
+int RandomMoveSource::ChooseCell(const GameStatus &gameStatus, int)
+{
+    int empty = EmptyCellCount(gameStatus);
+    if (empty == 0)
+    {
+        return -1;
+    }
+
+    std::uniform_int_distribution<int> pick(0, empty - 1);
+    return NthEmptyCell(gameStatus, pick(mRandom));
+}
+
+InputEvent EngineMoveSource::Poll(Entity game)
+{
+    auto &gameStatus = gCoordinator.ReadComponent<GameStatus>(game);
+    auto &playerTurn = gCoordinator.ReadComponent<PlayerTurn>(game);
+
+    int cell = ChooseCell(gameStatus, PlayerIndex(playerTurn.symbol));
+    if (cell < 0)
+    {
+        return InputEvent{};
+    }
+
+    return InputEvent{InputEventType::CELL, BoardPosition{cell / gameStatus.rules.width, cell % gameStatus.rules.width}};
+}
+
+// Board helpers
+
+int NthEmptyCell(const BoardRules &rules, const Bitboard (&marks)[2], int n)
+{
+    int cells = rules.width * rules.height;
+    for (int word = 0; word * 64 < cells; word++)
+    {
+        std::uint64_t empty = ~(marks[0].words[word] | marks[1].words[word]);
+        if (cells - word * 64 < 64)
+        {
+            empty &= (std::uint64_t(1) << (cells - word * 64)) - 1;
+        }
+
+        int count = PopCount(empty);
+        if (n < count)
+        {
+            for (; n > 0; n--)
+            {
+                empty &= empty - 1;
+            }
+
+            return word * 64 + LowestBit(empty);
+        }
+        n -= count;
+    }
+
+    assert(false && "Not that many empty cells.");
+    return -1;
+}
+
+bool ValidBoardRules(const BoardRules &rules)
+{
+    return rules.width >= 1 && rules.width <= MAX_BOARD_SIDE && rules.height >= 1 && rules.height <= MAX_BOARD_SIDE &&
+           rules.winLength >= 1 && rules.winLength <= std::max(rules.width, rules.height);
+}
+
+bool ParseBoardRules(const char *text, BoardRules &rules)
+{
+    BoardRules parsed{};
+    if (std::sscanf(text, "%d,%d,%d", &parsed.width, &parsed.height, &parsed.winLength) != 3)
+    {
+        return false;
+    }
+
+    if (!ValidBoardRules(parsed))
+    {
+        return false;
+    }
+
+    rules = parsed;
+    return true;
+}
+
+// Row and column steps of the four line directions: horizontal, vertical and both diagonals
+static constexpr int DIRECTIONS[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+
+bool CompletesLine(const BoardRules &rules, const Bitboard &marks, int cell, Bitboard *winningLine)
+{
+    int row = cell / rules.width;
+    int col = cell % rules.width;
+    int reach = rules.winLength - 1;
+
+    for (const auto &direction : DIRECTIONS)
+    {
+        // Gather the 2k - 1 cells of this direction centered on the move, bit reach is the move,
+        // so the cost depends on k and not on the board size
+        std::uint64_t line = 0;
+        for (int i = -reach; i <= reach; i++)
+        {
+            int r = row + i * direction[0];
+            int c = col + i * direction[1];
+            if (r >= 0 && r < rules.height && c >= 0 && c < rules.width && TestCell(marks, r * rules.width + c))
+            {
+                line |= std::uint64_t(1) << (i + reach);
+            }
+        }
+
+        // Shift-and-AND: once runs has seen `length` shifts, bit j is set when the `length`
+        // bits from j are all set. Doubling reaches k in log2(k) steps.
+        std::uint64_t runs = line;
+        int length = 1;
+        while (length * 2 <= rules.winLength)
+        {
+            runs &= runs >> length;
+            length *= 2;
+        }
+        if (length < rules.winLength)
+        {
+            runs &= runs >> (rules.winLength - length);
+        }
+
+        if (runs != 0)
+        {
+            if (winningLine != nullptr)
+            {
+                int start = LowestBit(runs) - reach;
+                for (int i = start; i < start + rules.winLength; i++)
+                {
+                    SetCell(*winningLine, (row + i * direction[0]) * rules.width + col + i * direction[1]);
+                }
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Rules
+
+void ApplyMove(GameStatus &gameStatus, int cell, int player)
+{
+    SetCell(gameStatus.marks[player], cell);
+    gameStatus.moveCount++;
+    gameStatus.lastMove = cell;
+}
+
+void EvaluateLastMove(GameStatus &gameStatus)
+{
+    if (gameStatus.lastMove < 0)
+    {
+        return;
+    }
+
+    int cell = gameStatus.lastMove;
+    gameStatus.lastMove = -1;
+
+    // Only the player who made the move can have completed a line through it
+    int player = TestCell(gameStatus.marks[0], cell) ? 0 : 1;
+    if (CompletesLine(gameStatus.rules, gameStatus.marks[player], cell, &gameStatus.winningLine))
+    {
+        gameStatus.status = player == 0 ? GameStatusEnum::X_WIN : GameStatusEnum::O_WIN;
+    }
+    else if (gameStatus.moveCount == gameStatus.rules.width * gameStatus.rules.height)
+    {
+        gameStatus.status = GameStatusEnum::DRAW;
+    }
+}
+
+// BoardLayout
+
+void BoardLayout::Build(const BoardRules &rules)
+{
+    mRules = rules;
+    mCells.assign(std::size_t(rules.width * rules.height), MAX_ENTITIES);
+    mCellSize = 0.0f;
+
+    gCoordinator.View<GridCell, BoardPosition>().Each([this](Entity entity, GridCell &cell, BoardPosition &position)
+                                                      {
+        if (position.row < 0 || position.row >= mRules.height || position.col < 0 || position.col >= mRules.width)
+        {
+            return;
+        }
+
+        mCells[CellIndex(mRules, position)] = entity;
+        if (position.row == 0 && position.col == 0)
+        {
+            mX = cell.rect.x;
+            mY = cell.rect.y;
+            mCellSize = cell.rect.width;
+        } });
+
+    mValid = mCellSize > 0.0f;
+}
+
+Entity BoardLayout::Cell(BoardPosition position) const
+{
+    if (!mValid || position.row < 0 || position.row >= mRules.height || position.col < 0 || position.col >= mRules.width)
+    {
+        return MAX_ENTITIES;
+    }
+
+    return mCells[CellIndex(mRules, position)];
+}
+
+bool BoardLayout::CellAt(float x, float y, BoardPosition &position) const
+{
+    if (!mValid)
+    {
+        return false;
+    }
+
+    float col = std::floor((x - mX) / mCellSize);
+    float row = std::floor((y - mY) / mCellSize);
+    if (col < 0.0f || row < 0.0f || col >= float(mRules.width) || row >= float(mRules.height))
+    {
+        return false;
+    }
+
+    position = BoardPosition{int(row), int(col)};
+    return true;
+}
+
+// GameSystem
+
+void GameSystem::Evaluate(Entity game)
+{
+    EvaluateLastMove(gCoordinator.GetComponent<GameStatus>(game));
+}
+
+GameSystem::GameSystem()
+{
+    Reads<PlayerTurn>();
+    Writes<GameStatus>();
+}
+
+void GameSystem::Update(ThreadPool &threadPool)
+{
+    mChanged.clear();
+    gCoordinator.EachChanged<GameStatus>(mChangesSeen, [this](Entity game)
+                                         {
+        if (mEntities.Contains(game))
+        {
+            mChanged.push_back(game);
+        } });
+
+    ParallelFor(threadPool, mChanged.size(), [this](std::size_t begin, std::size_t end)
+                {
+        for (std::size_t index = begin; index < end; ++index)
+        {
+            Evaluate(mChanged[index]);
+        } });
+
+    mChangesSeen = gCoordinator.AdvanceChangeTick();
+}
+
+// InputSystem
+
+InputSystem::InputSystem()
+{
+    Reads<BoardPosition, ResetButton>();
+    Writes<GridCell, GameStatus, PlayerTurn>();
+}
+
+void InputSystem::SetInputSource(std::shared_ptr<MoveSource> source)
+{
+    mInputSource = std::move(source);
+}
+
+void InputSystem::SetPlayerSource(char symbol, std::shared_ptr<MoveSource> source)
+{
+    mPlayerSources[symbol == 'X' ? 0 : 1] = std::move(source);
+}
+
+void InputSystem::SetRecorder(std::shared_ptr<InputLog> recorder)
+{
+    mRecorder = std::move(recorder);
+}
+
+void InputSystem::PlayCell(Entity game, BoardPosition move)
+{
+    Entity entity = mLayout.Cell(move);
+    if (entity == MAX_ENTITIES || gCoordinator.ReadComponent<GridCell>(entity).value != '-')
+    {
+        return;
+    }
+
+    auto &gameStatus = gCoordinator.GetComponent<GameStatus>(game);
+    auto &playerTurn = gCoordinator.GetComponent<PlayerTurn>(game);
+
+    gCoordinator.GetComponent<GridCell>(entity).value = playerTurn.symbol;
+    ApplyMove(gameStatus, CellIndex(gameStatus.rules, move), PlayerIndex(playerTurn.symbol));
+
+    playerTurn.symbol = playerTurn.symbol == 'X' ? 'O' : 'X';
+}
+
+void InputSystem::Reset(Entity game)
+{
+    if (mRecorder != nullptr)
+    {
+        mRecorder->Record(mFrame, InputEvent{InputEventType::RESET});
+    }
+
+    auto &gameStatus = gCoordinator.GetComponent<GameStatus>(game);
+    gameStatus = NewGameStatus(gameStatus.rules);
+    // X always opens
+    gCoordinator.GetComponent<PlayerTurn>(game).symbol = 'X';
+
+    gCoordinator.View<GridCell>().Each([](Entity entity, GridCell &cell)
+                                       {
+        if (cell.value != '-')
+        {
+            cell.value = '-';
+            gCoordinator.MarkChanged<GridCell>(entity);
+        } });
+}
+
+void InputSystem::Update(Entity game)
+{
+    mFrame++;
+    // Cells created or destroyed since the last build make it as stale as moved ones
+    if (!mLayout.Valid() || mLayout.CellCount() != mEntities.Size())
+    {
+        mLayout.Build(gCoordinator.ReadComponent<GameStatus>(game).rules);
+    }
+
+    InputEvent event = mInputSource != nullptr ? mInputSource->Poll(game) : InputEvent{};
+
+    if (event.type == InputEventType::RESET)
+    {
+        Reset(game);
+        return;
+    }
+
+    auto &gameStatus = gCoordinator.ReadComponent<GameStatus>(game);
+    if (gameStatus.status != GameStatusEnum::PLAYING)
+    {
+        return;
+    }
+
+    // A player with its own source ignores the shared input's clicks
+    auto &playerTurn = gCoordinator.ReadComponent<PlayerTurn>(game);
+    auto &playerSource = mPlayerSources[playerTurn.symbol == 'X' ? 0 : 1];
+    if (playerSource != nullptr)
+    {
+        event = playerSource->Poll(game);
+    }
+
+    if (event.type == InputEventType::CELL)
+    {
+        if (mRecorder != nullptr)
+        {
+            mRecorder->Record(mFrame, event);
+        }
+        PlayCell(game, event.cell);
+    }
+}
+
+// World setup
+
+void RegisterGame(std::shared_ptr<InputSystem> &inputSystem, std::shared_ptr<GameSystem> &gameSystem)
+{
+    gCoordinator.RegisterComponent<BoardPosition>();
+    gCoordinator.RegisterComponent<GridCell>();
+    gCoordinator.RegisterComponent<GameStatus>();
+    gCoordinator.RegisterComponent<PlayerTurn>();
+    gCoordinator.RegisterComponent<ResetButton>();
+
+    inputSystem = gCoordinator.RegisterSystem<InputSystem>();
+    gameSystem = gCoordinator.RegisterSystem<GameSystem>();
+
+    Signature inputSystemSignature;
+    inputSystemSignature.set(gCoordinator.GetComponentType<GridCell>());
+    gCoordinator.SetSystemSignature<InputSystem>(inputSystemSignature);
+
+    Signature gameSystemSignature;
+    gameSystemSignature.set(gCoordinator.GetComponentType<GameStatus>());
+    gameSystemSignature.set(gCoordinator.GetComponentType<PlayerTurn>());
+    gCoordinator.SetSystemSignature<GameSystem>(gameSystemSignature);
+}
+
+void CreateCells(const BoardRules &rules)
+{
+    // Create all cells in one batch, then lay them out
+    auto cells = gCoordinator.CreateEntities(rules.width * rules.height, BoardPosition{}, GridCell{'-', Rect{}});
+
+    for (int row = 0; row < rules.height; row++)
+    {
+        for (int col = 0; col < rules.width; col++)
+        {
+            gCoordinator.GetComponent<BoardPosition>(cells[row * rules.width + col]) = BoardPosition{row, col};
+        }
+    }
+
+    LayoutCells(rules, Rect{0.0f, 0.0f, 600.0f, 600.0f});
+}
+
+void LayoutCells(const BoardRules &rules, const Rect &bounds)
+{
+    auto size = std::min(bounds.width / rules.width, bounds.height / rules.height);
+
+    gCoordinator.View<GridCell, BoardPosition>().Each([&](Entity entity, GridCell &cell, BoardPosition &boardPosition)
+                                                      {
+        cell.rect = Rect{bounds.x + boardPosition.col * size, bounds.y + boardPosition.row * size, size, size};
+        gCoordinator.MarkChanged<GridCell>(entity); });
+}
+
+Entity CreateGame(const BoardRules &rules)
+{
+    auto game = gCoordinator.CreateEntity();
+    gCoordinator.AddComponent(game, NewGameStatus(rules));
+    gCoordinator.AddComponent(game, PlayerTurn{'X'});
+    gCoordinator.AddComponent(game, ResetButton{Rect{600, 400, 200, 100}});
+
+    return game;
+}
@@ -0,0 +1,503 @@
+#pragma once
+
+#include "entity-component-system.h"
+#include "thread-pool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <random>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifdef _WIN32
+#define GAME_EXPORT __declspec(dllexport)
+#else
+#define GAME_EXPORT
+#endif
+
+// Game rules and components, kept free of raylib so they can run without a window.
+
+extern Coordinator gCoordinator;
+
+// Components
+
+struct BoardPosition
+{
+    int row;
+    int col;
+};
+
+// Screen-space rectangle, same layout as raylib's Rectangle
+struct Rect
+{
+    float x;
+    float y;
+    float width;
+    float height;
+};
+
+struct GridCell
+{
+    // 'X', 'O', or '-'
+    char value;
+    Rect rect;
+};
+
+struct PlayerTurn
+{
+    char symbol;
+};
+
+struct ResetButton
+{
+    Rect rect;
+};
+
+// Enum for game status
+enum class GameStatusEnum
+{
+    PLAYING,
+    DRAW,
+    X_WIN,
+    O_WIN
+};
+
+// Largest board side, boards are up to MAX_BOARD_SIDE x MAX_BOARD_SIDE cells
+constexpr int MAX_BOARD_SIDE = 19;
+
+constexpr int BOARD_WORDS = (MAX_BOARD_SIDE * MAX_BOARD_SIDE + 63) / 64;
+
+/**
+ * @brief One bit per cell, bit row * width + col is the cell at (row, col).
+ */
+struct Bitboard
+{
+    std::uint64_t words[BOARD_WORDS];
+};
+
+inline bool TestCell(const Bitboard &board, int cell)
+{
+    return (board.words[cell >> 6] >> (cell & 63)) & 1;
+}
+
+inline void SetCell(Bitboard &board, int cell)
+{
+    board.words[cell >> 6] |= std::uint64_t(1) << (cell & 63);
+}
+
+inline int PopCount(std::uint64_t word)
+{
+#ifdef _MSC_VER
+    return int(__popcnt64(word));
+#else
+    return __builtin_popcountll(word);
+#endif
+}
+
+inline int LowestBit(std::uint64_t word)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return int(index);
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+inline int HighestBit(std::uint64_t word)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, word);
+    return int(index);
+#else
+    return 63 - __builtin_clzll(word);
+#endif
+}
+
+/**
+ * @brief An m,n,k game: a width x height board where winLength marks in a row win.
+ */
+struct BoardRules
+{
+    int width;
+    int height;
+    int winLength;
+};
+
+constexpr BoardRules CLASSIC_RULES{3, 3, 3};
+
+struct GameStatus
+{
+    GameStatusEnum status;
+    BoardRules rules;
+    // One bitboard per player, [0] for 'X' and [1] for 'O'
+    Bitboard marks[2];
+    // Cells of the winning line, empty until someone wins
+    Bitboard winningLine;
+    int moveCount;
+    // Cell index of the last move, -1 once GameSystem has evaluated it
+    int lastMove;
+};
+
+inline GameStatus NewGameStatus(const BoardRules &rules = CLASSIC_RULES)
+{
+    assert(rules.width > 0 && rules.width <= MAX_BOARD_SIDE && "Board width out of range.");
+    assert(rules.height > 0 && rules.height <= MAX_BOARD_SIDE && "Board height out of range.");
+    assert(rules.winLength > 0 && rules.winLength <= std::max(rules.width, rules.height) && "Win length out of range.");
+
+    return GameStatus{GameStatusEnum::PLAYING, rules, {}, {}, 0, -1};
+}
+
+inline int CellIndex(const BoardRules &rules, BoardPosition position)
+{
+    return position.row * rules.width + position.col;
+}
+
+inline int PlayerIndex(char symbol)
+{
+    return symbol == 'X' ? 0 : 1;
+}
+
+/**
+ * @brief Returns 'X', 'O' or '-' for the cell.
+ */
+inline char CellValue(const GameStatus &gameStatus, BoardPosition position)
+{
+    int cell = CellIndex(gameStatus.rules, position);
+    if (TestCell(gameStatus.marks[0], cell))
+    {
+        return 'X';
+    }
+
+    return TestCell(gameStatus.marks[1], cell) ? 'O' : '-';
+}
+
+inline int EmptyCellCount(const GameStatus &gameStatus)
+{
+    return gameStatus.rules.width * gameStatus.rules.height - gameStatus.moveCount;
+}
+
+/**
+ * @brief Returns the index of the n-th empty cell of the board, counting from cell 0.
+ */
+GAME_EXPORT int NthEmptyCell(const BoardRules &rules, const Bitboard (&marks)[2], int n);
+
+inline int NthEmptyCell(const GameStatus &gameStatus, int n)
+{
+    return NthEmptyCell(gameStatus.rules, gameStatus.marks, n);
+}
+
+/**
+ * @brief Marks `cell` for `player` (0 for 'X', 1 for 'O') and records it as the last move.
+ */
+GAME_EXPORT void ApplyMove(GameStatus &gameStatus, int cell, int player);
+
+/**
+ * @brief Updates the status after the last move: a win if it completed a line, a draw if the
+ * board is full. Does nothing when the last move was already evaluated.
+ */
+GAME_EXPORT void EvaluateLastMove(GameStatus &gameStatus);
+
+/**
+ * @brief Checks whether the mark at `cell` completes a line of winLength of the same marks.
+ *
+ * Only the four lines through the cell are scanned, so the cost depends on winLength and not
+ * on the board size. When a line is found and winningLine is not null, its cells are set there.
+ */
+GAME_EXPORT bool CompletesLine(const BoardRules &rules, const Bitboard &marks, int cell, Bitboard *winningLine = nullptr);
+
+/**
+ * @brief Whether the board fits MAX_BOARD_SIDE and a line of winLength fits the board.
+ */
+GAME_EXPORT bool ValidBoardRules(const BoardRules &rules);
+
+/**
+ * @brief Parses "width,height,winLength", for example "15,15,5".
+ *
+ * @return false if the text is not three numbers or the rules are not valid, see ValidBoardRules.
+ */
+GAME_EXPORT bool ParseBoardRules(const char *text, BoardRules &rules);
+
+// Input
+
+enum class InputEventType
+{
+    NONE,
+    CELL,
+    RESET
+};
+
+struct InputEvent
+{
+    InputEventType type = InputEventType::NONE;
+    // The cell to mark, for CELL events
+    BoardPosition cell{};
+};
+
+/**
+ * @brief Where InputSystem gets its moves from: the mouse, a script, an AI...
+ */
+class GAME_EXPORT MoveSource
+{
+public:
+    virtual ~MoveSource() = default;
+
+    /**
+     * @brief Returns this frame's event for the game, NONE when there is nothing to do.
+     */
+    virtual InputEvent Poll(Entity game) = 0;
+};
+
+/**
+ * @brief Plays back a fixed list of events, one per frame, then returns NONE.
+ */
+class GAME_EXPORT ScriptedMoveSource : public MoveSource
+{
+private:
+    std::deque<InputEvent> mEvents;
+
+public:
+    explicit ScriptedMoveSource(std::vector<InputEvent> events);
+
+    InputEvent Poll(Entity game) override;
+
+    // Whether every event has been played
+    bool Done() const
+    {
+        return mEvents.empty();
+    }
+};
+
+/**
+ * @brief One event InputSystem acted on, 8 bytes in the log.
+ */
+struct InputRecord
+{
+    // InputSystem frame the event was consumed in
+    std::uint32_t frame;
+    // InputEventType
+    std::uint8_t type;
+    std::uint8_t row;
+    std::uint8_t col;
+    std::uint8_t unused;
+};
+
+/**
+ * @brief The resolved events of a session: cells played and resets, whoever made them.
+ *
+ * Feeding Events() back through a ScriptedMoveSource on a board with the same rules, with no
+ * player sources, replays the session move for move. Frames without an event are skipped, so
+ * a replay runs as fast as the systems do.
+ */
+class GAME_EXPORT InputLog
+{
+private:
+    BoardRules mRules;
+    std::vector<InputRecord> mRecords{};
+
+public:
+    explicit InputLog(const BoardRules &rules = CLASSIC_RULES);
+
+    void Record(std::uint32_t frame, const InputEvent &event);
+
+    const BoardRules &Rules() const
+    {
+        return mRules;
+    }
+
+    const std::vector<InputRecord> &Records() const
+    {
+        return mRecords;
+    }
+
+    // The recorded events in order, one per replayed frame
+    std::vector<InputEvent> Events() const;
+
+    bool Save(const char *path) const;
+
+    /**
+     * @brief Replaces the log with a file written by Save, read through a memory mapping.
+     *
+     * @return false, leaving the log as it was, if the file cannot be read, is not an input log,
+     * is truncated, or has rules or records that do not fit a board.
+     */
+    bool Load(const char *path);
+};
+
+/**
+ * @brief A player that picks its moves from the board alone, the AIs.
+ *
+ * Poll asks ChooseCell for the player whose turn it is, ChooseCell also works on a bare
+ * GameStatus outside the ECS, see selfplay.cpp.
+ */
+class GAME_EXPORT EngineMoveSource : public MoveSource
+{
+public:
+    /**
+     * @brief Returns the cell index to mark for `toMove` (0 for 'X', 1 for 'O'), -1 to pass.
+     */
+    virtual int ChooseCell(const GameStatus &gameStatus, int toMove) = 0;
+
+    InputEvent Poll(Entity game) override;
+};
+
+/**
+ * @brief Marks a uniformly random empty cell every frame.
+ */
+class GAME_EXPORT RandomMoveSource : public EngineMoveSource
+{
+private:
+    std::mt19937 mRandom;
+
+public:
+    explicit RandomMoveSource(std::uint32_t seed);
+
+    int ChooseCell(const GameStatus &gameStatus, int toMove) override;
+};
+
+// Board layout
+
+/**
+ * @brief Finds cell entities by arithmetic instead of testing every cell.
+ *
+ * The cells are equal squares laid out row by row (see LayoutCells), so a screen point divides
+ * into a row and a column, and those index the cell entities. Build reads the layout from the
+ * cells once. Invalidate it whenever the cells move or are recreated; a stale layout finds no
+ * cell until it is built again.
+ */
+class GAME_EXPORT BoardLayout
+{
+private:
+    BoardRules mRules{};
+    // Top-left corner of the cell at (0, 0)
+    float mX = 0.0f;
+    float mY = 0.0f;
+    float mCellSize = 0.0f;
+    // Cell entities by cell index
+    std::vector<Entity> mCells{};
+    bool mValid = false;
+
+public:
+    /**
+     * @brief Indexes every entity with a GridCell and a BoardPosition on a board of `rules`.
+     */
+    void Build(const BoardRules &rules);
+
+    void Invalidate()
+    {
+        mValid = false;
+    }
+
+    bool Valid() const
+    {
+        return mValid;
+    }
+
+    std::size_t CellCount() const
+    {
+        return mCells.size();
+    }
+
+    /**
+     * @brief Returns the cell entity at the position, MAX_ENTITIES when it is off the board or
+     * the layout is stale.
+     */
+    Entity Cell(BoardPosition position) const;
+
+    /**
+     * @brief Finds the cell under a screen point, with the same edges as CheckCollisionPointRec.
+     *
+     * @return false when the point is off the board or the layout is stale.
+     */
+    bool CellAt(float x, float y, BoardPosition &position) const;
+};
+
+// Systems
+
+class GAME_EXPORT GameSystem : public System
+{
+private:
+    // Games whose status changed since the last update, reused between updates
+    std::vector<Entity> mChanged{};
+
+    void Evaluate(Entity game);
+
+public:
+    GameSystem();
+
+    /**
+     * @brief Evaluates the last move of every game whose status changed since the last update,
+     * spread over the thread pool since games are independent. Idle games cost nothing.
+     */
+    void Update(ThreadPool &threadPool);
+};
+
+class GAME_EXPORT InputSystem : public System
+{
+private:
+    // Shared input (mouse, script), polled every frame for cell clicks and resets
+    std::shared_ptr<MoveSource> mInputSource;
+    // Optional per-player sources for 'X' and 'O', they replace the shared input's cell moves
+    std::shared_ptr<MoveSource> mPlayerSources[2];
+    // Receives every event the system acts on, when set
+    std::shared_ptr<InputLog> mRecorder;
+    // Updates run so far, events are recorded with the number of the update, from 1
+    std::uint32_t mFrame = 0;
+    // Where the cells are, rebuilt by Update once it is invalidated or the cells change
+    BoardLayout mLayout;
+
+    void PlayCell(Entity game, BoardPosition move);
+
+public:
+    InputSystem();
+
+    void SetInputSource(std::shared_ptr<MoveSource> source);
+    void SetPlayerSource(char symbol, std::shared_ptr<MoveSource> source);
+    void SetRecorder(std::shared_ptr<InputLog> recorder);
+
+    /**
+     * @brief The cells by position and by screen point, for sources that hit-test the mouse.
+     */
+    const BoardLayout &Layout() const
+    {
+        return mLayout;
+    }
+
+    // Call after moving the cells, for example with LayoutCells on a window resize
+    void InvalidateLayout()
+    {
+        mLayout.Invalidate();
+    }
+
+    /**
+     * @brief Clears the board and the cells for a new game, X opens. Recorded like a reset event.
+     */
+    void Reset(Entity game);
+
+    void Update(Entity game);
+};
+
+/**
+ * @brief Registers the game components and the input and game systems with their signatures.
+ */
+GAME_EXPORT void RegisterGame(std::shared_ptr<InputSystem> &inputSystem, std::shared_ptr<GameSystem> &gameSystem);
+
+/**
+ * @brief Creates one cell entity per board cell, laid out over a 600x600 area.
+ */
+GAME_EXPORT void CreateCells(const BoardRules &rules = CLASSIC_RULES);
+
+/**
+ * @brief Lays the cells out as the largest equal squares that fit `bounds`, row by row from
+ * its top-left corner. Invalidate the input system's layout afterwards.
+ */
+GAME_EXPORT void LayoutCells(const BoardRules &rules, const Rect &bounds);
+GAME_EXPORT Entity CreateGame(const BoardRules &rules = CLASSIC_RULES);
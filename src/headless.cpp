@@ -0,0 +1,221 @@
+#include "game.h"
+#include "mcts.h"
+#include "perfect-play.h"
+#include "profiler.h"
+#include "scheduler.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+// Plays random-vs-random games through the same systems as the windowed game, without raylib.
+// With --perfect, 'O' plays perfectly instead and X should never win. With --mcts, 'O' runs a
+// tree search of that many playouts per move on all cores. --board picks an m,n,k board such
+// as 15,15,5.
+//
+// --record FILE saves every move and reset as an input log. --replay FILE plays a log recorded
+// here or by `triqui --record` back through the same systems, on the board it was recorded on,
+// and reports how fast it ran.
+//
+// Usage: triqui_headless [--games N] [--seed S] [--perfect | --mcts PLAYOUTS] [--board width,height,winLength]
+//                        [--record FILE | --replay FILE]
+//
+// Built with TRIQUI_PROFILE, --trace FILE writes a Chrome trace and --profile-csv FILE the
+// time of every system per frame.
+
+int main(int argc, char **argv)
+{
+    long games = 1000;
+    std::uint32_t seed = 1;
+    bool perfect = false;
+    std::uint64_t mctsPlayouts = 0;
+    BoardRules rules = CLASSIC_RULES;
+    const char *recordPath = nullptr;
+    const char *replayPath = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--games") == 0 && i + 1 < argc)
+        {
+            games = std::atol(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--perfect") == 0)
+        {
+            perfect = true;
+        }
+        else if (std::strcmp(argv[i], "--mcts") == 0 && i + 1 < argc)
+        {
+            mctsPlayouts = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--board") == 0 && i + 1 < argc && ParseBoardRules(argv[i + 1], rules))
+        {
+            i++;
+        }
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            recordPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            replayPath = argv[++i];
+        }
+#ifdef TRIQUI_PROFILE
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc && Profiler::Instance().OpenTrace(argv[i + 1]))
+        {
+            i++;
+        }
+        else if (std::strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc && Profiler::Instance().OpenCsv(argv[i + 1]))
+        {
+            i++;
+        }
+#endif
+        else
+        {
+            std::fprintf(stderr,
+                         "usage: %s [--games N] [--seed S] [--perfect | --mcts PLAYOUTS] [--board width,height,winLength] "
+                         "[--record FILE | --replay FILE]\n",
+                         argv[0]);
+            return 1;
+        }
+    }
+
+    InputLog replayLog;
+    if (replayPath != nullptr)
+    {
+        if (!replayLog.Load(replayPath))
+        {
+            std::fprintf(stderr, "cannot read input log %s\n", replayPath);
+            return 1;
+        }
+        rules = replayLog.Rules();
+    }
+
+    ThreadPool threadPool;
+
+    gCoordinator.Init();
+    std::shared_ptr<InputSystem> inputSystem;
+    std::shared_ptr<GameSystem> gameSystem;
+    RegisterGame(inputSystem, gameSystem);
+
+    std::shared_ptr<ScriptedMoveSource> replay;
+    std::shared_ptr<InputLog> recorder;
+    std::shared_ptr<MctsMoveSource> mcts;
+    if (replayPath != nullptr)
+    {
+        // The log holds every move of both players, so nobody else plays
+        replay = std::make_shared<ScriptedMoveSource>(replayLog.Events());
+        inputSystem->SetInputSource(replay);
+    }
+    else
+    {
+        inputSystem->SetPlayerSource('X', std::make_shared<RandomMoveSource>(seed));
+        if (perfect)
+        {
+            inputSystem->SetPlayerSource('O', std::make_shared<PerfectMoveSource>());
+        }
+        else if (mctsPlayouts > 0)
+        {
+            MctsConfig config;
+            config.limits = MctsLimits{0.0, mctsPlayouts};
+            config.seed = seed + 1;
+            mcts = std::make_shared<MctsMoveSource>(threadPool, config);
+            inputSystem->SetPlayerSource('O', mcts);
+        }
+        else
+        {
+            inputSystem->SetPlayerSource('O', std::make_shared<RandomMoveSource>(seed + 1));
+        }
+
+        if (recordPath != nullptr)
+        {
+            recorder = std::make_shared<InputLog>(rules);
+            inputSystem->SetRecorder(recorder);
+        }
+    }
+
+    auto game = CreateGame(rules);
+    CreateCells(rules);
+
+    Scheduler scheduler;
+    scheduler.Add(inputSystem, [&]
+                  { inputSystem->Update(game); },
+                  "InputSystem::Update");
+    scheduler.Add(gameSystem, [&]
+                  { gameSystem->Update(threadPool); },
+                  "GameSystem::Update");
+
+    long xWins = 0;
+    long oWins = 0;
+    long draws = 0;
+    long frames = 0;
+    // Whether the finished game on the board has been counted
+    bool counted = false;
+
+    auto start = std::chrono::steady_clock::now();
+    while (replay != nullptr ? !replay->Done() : xWins + oWins + draws < games)
+    {
+        scheduler.Run(threadPool);
+        gCoordinator.FlushCommands();
+        frames++;
+        PROFILE_COUNTER("entities", gCoordinator.GetLivingEntityCount());
+        PROFILE_FRAME();
+
+        auto &gameStatus = gCoordinator.ReadComponent<GameStatus>(game);
+        if (gameStatus.status == GameStatusEnum::PLAYING)
+        {
+            counted = false;
+            continue;
+        }
+
+        if (!counted)
+        {
+            xWins += gameStatus.status == GameStatusEnum::X_WIN;
+            oWins += gameStatus.status == GameStatusEnum::O_WIN;
+            draws += gameStatus.status == GameStatusEnum::DRAW;
+            counted = true;
+        }
+
+        // A replay resets the board when the log does
+        if (replay == nullptr)
+        {
+            inputSystem->Reset(game);
+            // The next game can end in the frame it starts, with a win length of 1, so it is
+            // counted without waiting for a PLAYING frame
+            counted = false;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    games = xWins + oWins + draws;
+
+    if (recorder != nullptr && !recorder->Save(recordPath))
+    {
+        std::fprintf(stderr, "cannot write input log %s\n", recordPath);
+        return 1;
+    }
+
+    if (replay != nullptr)
+    {
+        std::printf("replay %zu events, recorded over %u frames\n", replayLog.Records().size(),
+                    replayLog.Records().empty() ? 0u : replayLog.Records().back().frame);
+    }
+    std::printf("games  %ld\n", games);
+    std::printf("X wins %ld\n", xWins);
+    std::printf("O wins %ld\n", oWins);
+    std::printf("draws  %ld\n", draws);
+    std::printf("frames %ld\n", frames);
+    std::printf("%.0f games/s, %.0f frames/s\n", seconds > 0 ? games / seconds : 0.0, seconds > 0 ? frames / seconds : 0.0);
+    if (mcts != nullptr)
+    {
+        std::printf("mcts   %llu playouts, %.0f playouts/s, up to %u nodes\n", static_cast<unsigned long long>(mcts->Total().playouts),
+                    mcts->Total().PlayoutsPerSecond(), mcts->Total().nodes);
+    }
+
+    return 0;
+}
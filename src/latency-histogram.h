@@ -0,0 +1,80 @@
+#pragma once
+
+#include "game.h"
+
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * @brief Log-linear latency histogram: 8 buckets per power of two of nanoseconds.
+ */
+struct LatencyHistogram
+{
+    static constexpr int SUB_BUCKETS = 8;
+    static constexpr int BUCKETS = 64 * SUB_BUCKETS;
+
+    std::uint64_t counts[BUCKETS] = {};
+    std::uint64_t total = 0;
+    std::uint64_t sumNs = 0;
+    std::uint64_t maxNs = 0;
+
+    static int Bucket(std::uint64_t ns)
+    {
+        if (ns < SUB_BUCKETS)
+        {
+            return int(ns);
+        }
+
+        int log = HighestBit(ns);
+        int sub = int(ns >> (log - 3)) & (SUB_BUCKETS - 1);
+        return log * SUB_BUCKETS + sub;
+    }
+
+    // Upper bound of the bucket's range
+    static std::uint64_t BucketLimit(int bucket)
+    {
+        if (bucket < SUB_BUCKETS)
+        {
+            return std::uint64_t(bucket);
+        }
+
+        int log = bucket / SUB_BUCKETS;
+        int sub = bucket % SUB_BUCKETS;
+        return ((std::uint64_t(SUB_BUCKETS + sub + 1)) << (log - 3)) - 1;
+    }
+
+    void Add(std::uint64_t ns)
+    {
+        counts[Bucket(ns)]++;
+        total++;
+        sumNs += ns;
+        maxNs = std::max(maxNs, ns);
+    }
+
+    void Merge(const LatencyHistogram &other)
+    {
+        for (int i = 0; i < BUCKETS; i++)
+        {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+        sumNs += other.sumNs;
+        maxNs = std::max(maxNs, other.maxNs);
+    }
+
+    std::uint64_t Percentile(double fraction) const
+    {
+        std::uint64_t rank = std::uint64_t(fraction * double(total));
+        std::uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++)
+        {
+            seen += counts[i];
+            if (seen > rank)
+            {
+                return std::min(BucketLimit(i), maxNs);
+            }
+        }
+
+        return maxNs;
+    }
+};
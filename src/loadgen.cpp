@@ -0,0 +1,308 @@
+#include "game.h"
+#include "latency-histogram.h"
+#include "match-protocol.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <sys/epoll.h>
+
+// Drives a triqui_server with simulated players, one connection each, that join matches and
+// answer every move at once with a random empty cell. Reports moves per second and the time
+// from sending a move to receiving its echo.
+//
+// Usage: triqui_loadgen [--players N] [--seconds S] [--seed S] [--host ADDRESS] [--port P | --unix PATH]
+
+namespace
+{
+    constexpr int MAX_EVENTS = 1024;
+
+    struct Player
+    {
+        int socket = -1;
+        MatchBuffers buffers;
+        bool dirty = false;
+        // The board as this player has seen it, kept with the same rules as the server
+        GameStatus gameStatus{};
+        // 0 for 'X', 1 for 'O'
+        int side = 0;
+        std::uint32_t sequence = 0;
+        // When the move numbered sequence was sent, 0 once its echo came back
+        std::uint64_t sentNs = 0;
+    };
+
+    struct Totals
+    {
+        LatencyHistogram latency;
+        std::uint64_t games = 0;
+        std::uint64_t forfeits = 0;
+        std::uint64_t rejected = 0;
+    };
+
+    std::uint64_t NowNs()
+    {
+        return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    int Connect(const char *host, std::uint16_t port, const char *unixPath)
+    {
+        int socket = -1;
+        if (unixPath != nullptr)
+        {
+            sockaddr_un address;
+            if (!FillUnixAddress(unixPath, address))
+            {
+                return -1;
+            }
+            socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (socket >= 0 && ::connect(socket, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+            {
+                ::close(socket);
+                return -1;
+            }
+        }
+        else
+        {
+            sockaddr_in address;
+            if (!FillTcpAddress(host, port, address))
+            {
+                return -1;
+            }
+            socket = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (socket >= 0 && ::connect(socket, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+            {
+                ::close(socket);
+                return -1;
+            }
+            int noDelay = 1;
+            ::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        }
+
+        if (socket >= 0 && !SetNonBlocking(socket))
+        {
+            ::close(socket);
+            return -1;
+        }
+        return socket;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    long players = 1000;
+    double duration = 10.0;
+    std::uint32_t seed = 1;
+    const char *host = "127.0.0.1";
+    long port = DEFAULT_MATCH_PORT;
+    const char *unixPath = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--players") == 0 && i + 1 < argc)
+        {
+            players = std::atol(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+        {
+            duration = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--host") == 0 && i + 1 < argc)
+        {
+            host = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc)
+        {
+            port = std::atol(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--unix") == 0 && i + 1 < argc)
+        {
+            unixPath = argv[++i];
+        }
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--players N] [--seconds S] [--seed S] [--host ADDRESS] [--port P | --unix PATH]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (players < 2)
+    {
+        std::fprintf(stderr, "a match needs at least 2 players\n");
+        return 1;
+    }
+
+    RaiseFileLimit();
+    int epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    std::vector<std::unique_ptr<Player>> sessions;
+    sessions.reserve(std::size_t(players));
+    std::vector<std::uint32_t> dirty;
+    std::mt19937 random(seed);
+    Totals totals;
+
+    auto send = [&](std::uint32_t index, const MatchMessage &message)
+    {
+        Player &player = *sessions[index];
+        player.buffers.Push(message);
+        if (!player.dirty)
+        {
+            player.dirty = true;
+            dirty.push_back(index);
+        }
+    };
+
+    auto move = [&](std::uint32_t index)
+    {
+        Player &player = *sessions[index];
+        const GameStatus &gameStatus = player.gameStatus;
+        int cell = NthEmptyCell(gameStatus, int(random() % std::uint32_t(EmptyCellCount(gameStatus))));
+        player.sequence++;
+        player.sentNs = NowNs();
+        send(index, MatchMessage{MatchMessageType::MOVE, '-', std::uint8_t(cell / gameStatus.rules.width),
+                                 std::uint8_t(cell % gameStatus.rules.width), player.sequence});
+    };
+
+    // Every player only moves in its turn, right after it learns of it
+    auto handle = [&](std::uint32_t index, const MatchMessage &message)
+    {
+        Player &player = *sessions[index];
+        switch (message.type)
+        {
+        case MatchMessageType::START:
+            player.gameStatus = NewGameStatus(BoardRules{message.row, message.col, int(message.sequence)});
+            player.side = PlayerIndex(message.symbol);
+            if (player.side == 0)
+            {
+                move(index);
+            }
+            return true;
+        case MatchMessageType::MOVED:
+        {
+            int mover = PlayerIndex(message.symbol);
+            ApplyMove(player.gameStatus, CellIndex(player.gameStatus.rules, BoardPosition{message.row, message.col}), mover);
+            EvaluateLastMove(player.gameStatus);
+            if (mover == player.side)
+            {
+                if (message.sequence == player.sequence && player.sentNs != 0)
+                {
+                    totals.latency.Add(NowNs() - player.sentNs);
+                    player.sentNs = 0;
+                }
+            }
+            else if (player.gameStatus.status == GameStatusEnum::PLAYING)
+            {
+                move(index);
+            }
+            return true;
+        }
+        case MatchMessageType::REJECTED:
+            totals.rejected++;
+            player.sentNs = 0;
+            return true;
+        case MatchMessageType::OVER:
+            // Both players hear of a finished game, 'X' counts it, a forfeit only reaches the winner
+            if (message.row == 1)
+            {
+                totals.forfeits++;
+            }
+            else if (player.side == 0)
+            {
+                totals.games++;
+            }
+            send(index, MatchMessage{MatchMessageType::JOIN, '-', 0, 0, 0});
+            return true;
+        default:
+            return false;
+        }
+    };
+
+    for (long i = 0; i < players; i++)
+    {
+        int socket = Connect(host, std::uint16_t(port), unixPath);
+        if (socket < 0)
+        {
+            std::fprintf(stderr, "cannot connect player %ld: %s\n", i, std::strerror(errno));
+            return 1;
+        }
+
+        auto index = std::uint32_t(sessions.size());
+        sessions.push_back(std::make_unique<Player>());
+        sessions.back()->socket = socket;
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u32 = index;
+        ::epoll_ctl(epoll, EPOLL_CTL_ADD, socket, &event);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(duration));
+    for (std::uint32_t index = 0; index < sessions.size(); index++)
+    {
+        send(index, MatchMessage{MatchMessageType::JOIN, '-', 0, 0, 0});
+    }
+
+    epoll_event events[MAX_EVENTS];
+    long lost = 0;
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        // Send what the last batch queued, then wait for the replies
+        for (std::uint32_t index : dirty)
+        {
+            Player &player = *sessions[index];
+            player.dirty = false;
+            // A full socket buffer is not expected at these message rates, treat it as lost
+            if (player.socket >= 0 && (!player.buffers.Flush(player.socket) || player.buffers.Pending()))
+            {
+                ::close(player.socket);
+                player.socket = -1;
+                lost++;
+            }
+        }
+        dirty.clear();
+
+        int count = ::epoll_wait(epoll, events, MAX_EVENTS, 100);
+        for (int i = 0; i < count; i++)
+        {
+            std::uint32_t index = events[i].data.u32;
+            Player &player = *sessions[index];
+            if (player.socket >= 0 && !player.buffers.Receive(player.socket, [&](const MatchMessage &message)
+                                                               { return handle(index, message); }))
+            {
+                ::close(player.socket);
+                player.socket = -1;
+                lost++;
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const auto &player : sessions)
+    {
+        if (player->socket >= 0)
+        {
+            ::close(player->socket);
+        }
+    }
+    ::close(epoll);
+
+    const LatencyHistogram &latency = totals.latency;
+    std::printf("%ld players over %s, %.1f s\n", players, unixPath != nullptr ? unixPath : "tcp", seconds);
+    std::printf("%llu moves, %.0f moves/s, %llu games, %.0f games/s, %llu forfeits, %llu rejected, %ld connections lost\n",
+                static_cast<unsigned long long>(latency.total), latency.total / seconds, static_cast<unsigned long long>(totals.games),
+                totals.games / seconds, static_cast<unsigned long long>(totals.forfeits), static_cast<unsigned long long>(totals.rejected), lost);
+    std::printf("%-18s %10s %10s %10s %10s %10s\n", "move latency (us)", "mean", "p50", "p90", "p99", "max");
+    std::printf("%-18s %10.2f %10.2f %10.2f %10.2f %10.2f\n", "", latency.total ? latency.sumNs / 1000.0 / latency.total : 0.0,
+                latency.Percentile(0.50) / 1000.0, latency.Percentile(0.90) / 1000.0, latency.Percentile(0.99) / 1000.0, latency.maxNs / 1000.0);
+
+    return lost > 0 ? 1 : 0;
+}
@@ -1,312 +1,440 @@
-#include "entity-component-system.h"
+#include "game.h"
+#include "mcts.h"
+#include "perfect-play.h"
+#include "profiler.h"
+#include "scheduler.h"
 #include <raylib.h>
-#include <vector>
-#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <string>
 #include <vector>
 
-Coordinator gCoordinator;
-
-// Components
-
-struct BoardPosition
+static Rectangle ToRectangle(const Rect &rect)
 {
-    int row;
-    int col;
-};
+    return Rectangle{rect.x, rect.y, rect.width, rect.height};
+}
 
-struct GridCell
+/**
+ * @brief Turns left clicks into input events, on the reset button or on a cell.
+ *
+ * A click is tested once, and the cell under it is found from the board layout without
+ * visiting the other cells.
+ */
+class MouseMoveSource : public MoveSource
 {
-    // 'X', 'O', or '-'
-    char value;
-    Rectangle rect;
-};
+private:
+    const BoardLayout &mLayout;
 
-struct PlayerTurn
-{
-    char symbol;
-};
+public:
+    explicit MouseMoveSource(const BoardLayout &layout) : mLayout(layout)
+    {
+    }
 
-struct ResetButton
-{
-    Rectangle rect;
+    InputEvent Poll(Entity game) override
+    {
+        if (!IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+        {
+            return InputEvent{};
+        }
+
+        auto mousePosition = GetMousePosition();
+        auto &resetButton = gCoordinator.ReadComponent<ResetButton>(game);
+        if (CheckCollisionPointRec(mousePosition, ToRectangle(resetButton.rect)))
+        {
+            return InputEvent{InputEventType::RESET};
+        }
+
+        BoardPosition position;
+        if (mLayout.CellAt(mousePosition.x, mousePosition.y, position))
+        {
+            return InputEvent{InputEventType::CELL, position};
+        }
+
+        return InputEvent{};
+    }
 };
 
-// Enum for game status
-enum class GameStatusEnum
+/**
+ * @brief Fits the board to the window: the largest square that leaves a 200 pixel column on
+ * the right for the reset button.
+ *
+ * @return The side of the board in pixels.
+ */
+static int LayoutWindow(Entity game, const BoardRules &rules)
 {
-    PLAYING,
-    DRAW,
-    X_WIN,
-    O_WIN
-};
+    int side = std::max(1, std::min(GetScreenWidth() - 200, GetScreenHeight()));
+    LayoutCells(rules, Rect{0.0f, 0.0f, float(side), float(side)});
+    gCoordinator.GetComponent<ResetButton>(game).rect = Rect{float(side), float(std::max(0, side - 200)), 200.0f, 100.0f};
+
+    return side;
+}
 
-struct GameStatus
+#ifdef TRIQUI_PROFILE
+template <typename T>
+static std::int64_t CountComponents()
 {
-    GameStatusEnum status;
-    // array for storing the board
-    std::vector<std::vector<char>> board;
-    std::vector<BoardPosition> winningPositions;
-};
+    std::int64_t count = 0;
+    gCoordinator.View<T>().Each([&](Entity, T &)
+                                { count++; });
+    return count;
+}
 
-class GameSystem : public System
+/**
+ * @brief Draws a histogram of the recent frame times, the last frame's scopes and the counters
+ * in the column right of the board.
+ *
+ * @param x Left edge of the column, the side of the board.
+ */
+static void DrawProfilerOverlay(int x)
 {
-private:
-    bool RowWinner(GameStatus &gameStatus, int row)
-    {
-        return gameStatus.board[row][0] == gameStatus.board[row][1] && gameStatus.board[row][1] == gameStatus.board[row][2] && gameStatus.board[row][0] != '-';
-    }
+    const Profiler &profiler = Profiler::Instance();
+    const int width = 200;
+    const int graphHeight = 80;
+    const int barWidth = width / int(Profiler::FRAME_BUCKETS);
+
+    DrawRectangle(x, 0, width, GetScreenHeight(), Fade(BLACK, 0.85f));
 
-    bool ColumnWinner(GameStatus &gameStatus, int col)
+    auto histogram = profiler.FrameTimeHistogram();
+    std::uint32_t tallest = std::max(1u, *std::max_element(histogram.begin(), histogram.end()));
+    for (std::size_t bucket = 0; bucket < histogram.size(); bucket++)
     {
-        return gameStatus.board[0][col] == gameStatus.board[1][col] && gameStatus.board[1][col] == gameStatus.board[2][col] && gameStatus.board[0][col] != '-';
+        float milliseconds = float(bucket) * Profiler::FRAME_BUCKET_MILLISECONDS;
+        int height = int(histogram[bucket] * std::uint32_t(graphHeight) / tallest);
+        Color color = milliseconds < 1000.0f / 60.0f ? GREEN : milliseconds < 1000.0f / 30.0f ? ORANGE
+                                                                                               : RED;
+        DrawRectangle(x + int(bucket) * barWidth, graphHeight - height, barWidth - 1, height, color);
     }
 
-    bool ForwardDiagonalWinner(GameStatus &gameStatus)
+    int y = graphHeight + 4;
+    DrawText(TextFormat("0 - %.0f+ ms, last %zu frames", Profiler::FRAME_BUCKETS * Profiler::FRAME_BUCKET_MILLISECONDS,
+                        profiler.FrameTimeCount()),
+             x + 4, y, 10, LIGHTGRAY);
+    y += 12;
+    if (profiler.FrameTimeCount() > 0)
     {
-        return gameStatus.board[0][0] == gameStatus.board[1][1] && gameStatus.board[1][1] == gameStatus.board[2][2] && gameStatus.board[0][0] != '-';
+        DrawText(TextFormat("frame %.2f ms", profiler.FrameTime(0)), x + 4, y, 10, WHITE);
+        y += 12;
     }
-
-    bool BackwardDiagonalWinner(GameStatus &gameStatus)
+    for (const auto &scope : profiler.Scopes())
     {
-        return gameStatus.board[0][2] == gameStatus.board[1][1] && gameStatus.board[1][1] == gameStatus.board[2][0] && gameStatus.board[0][2] != '-';
+        DrawText(TextFormat("%s %.3f ms x%llu", scope.name, scope.nanoseconds / 1e6, static_cast<unsigned long long>(scope.calls)), x + 4, y, 10,
+                 WHITE);
+        y += 12;
     }
-
-    bool Draw(GameStatus &gameStatus)
+    for (const auto &counter : profiler.Counters())
     {
-        for (int i = 0; i < 3; i++)
-        {
-            for (int j = 0; j < 3; j++)
-            {
-                if (gameStatus.board[i][j] == '-')
-                {
-                    return false;
-                }
-            }
-        }
-
-        return true;
+        DrawText(TextFormat("%s %lld", counter.name, static_cast<long long>(counter.value)), x + 4, y, 10, LIGHTGRAY);
+        y += 12;
     }
-
-public:
-    void Update(Entity game)
+    if (profiler.Dropped() > 0)
     {
-        auto &gameStatus = gCoordinator.GetComponent<GameStatus>(game);
-        auto &playerTurn = gCoordinator.GetComponent<PlayerTurn>(game);
-
-        // Check for winner
-        for (int i = 0; i < 3; i++)
-        {
-            // @TODO: combine row and column checks.
-            if (RowWinner(gameStatus, i))
-            {
-                gameStatus.status = gameStatus.board[i][0] == 'X' ? GameStatusEnum::X_WIN : GameStatusEnum::O_WIN;
-                gameStatus.winningPositions = {BoardPosition{i, 0}, BoardPosition{i, 1}, BoardPosition{i, 2}};
-            }
-            else if (ColumnWinner(gameStatus, i))
-            {
-                gameStatus.status = gameStatus.board[0][i] == 'X' ? GameStatusEnum::X_WIN : GameStatusEnum::O_WIN;
-                gameStatus.winningPositions = {BoardPosition{0, i}, BoardPosition{1, i}, BoardPosition{2, i}};
-            }
-            else if (ForwardDiagonalWinner(gameStatus))
-            {
-                gameStatus.status = gameStatus.board[0][0] == 'X' ? GameStatusEnum::X_WIN : GameStatusEnum::O_WIN;
-                gameStatus.winningPositions = {BoardPosition{0, 0}, BoardPosition{1, 1}, BoardPosition{2, 2}};
-            }
-            else if (BackwardDiagonalWinner(gameStatus))
-            {
-                gameStatus.status = gameStatus.board[0][2] == 'X' ? GameStatusEnum::X_WIN : GameStatusEnum::O_WIN;
-                gameStatus.winningPositions = {BoardPosition{0, 2}, BoardPosition{1, 1}, BoardPosition{2, 0}};
-            }
-            else if (Draw(gameStatus))
-            {
-                gameStatus.status = GameStatusEnum::DRAW;
-            }
-        }
+        DrawText(TextFormat("dropped events %llu", static_cast<unsigned long long>(profiler.Dropped())), x + 4, y, 10, RED);
     }
-};
+}
+#endif
+
+// Systems
 
-class InputSystem : public System
+/**
+ * @brief Draws the board in retained mode.
+ *
+ * The cells live in a render texture that only has the cells whose value or highlight changed
+ * since the last frame drawn again, a frame where nothing changed is one blit of the texture.
+ * Only the cells marked changed are compared, unless the game status changed, which can
+ * highlight or clear any cell, or Load just made a new texture.
+ */
+class RenderSystem : public System
 {
 private:
-    void UpdateGameBoard(Entity game, char symbol, BoardPosition move)
+    struct DrawnCell
+    {
+        // 0 until the cell is drawn for the first time
+        char value = 0;
+        bool winning = false;
+    };
+
+    RenderTexture2D mBoard{};
+    // What the texture shows for each cell, by cell index
+    std::vector<DrawnCell> mDrawn{};
+    // Whether the texture is between BeginTextureMode and EndTextureMode
+    bool mDrawing = false;
+    // Set by Load, a new texture has every cell drawn on the next update
+    bool mRedrawAll = false;
+
+    void RenderResetButton(Entity game)
     {
-        auto &gameStatus = gCoordinator.GetComponent<GameStatus>(game);
-        gameStatus.board[move.row][move.col] = symbol;
+        auto &resetButton = gCoordinator.ReadComponent<ResetButton>(game);
+        DrawRectangleRec(ToRectangle(resetButton.rect), RED);
+        DrawText("Reset", resetButton.rect.x + 50, resetButton.rect.y + 50, 50, BLACK);
     }
 
-    void CheckCellCollision(Entity game)
+    // Draws the cell into the texture if it differs from what the texture shows
+    void RedrawCell(const GameStatus &gameStatus, const GridCell &cell, const BoardPosition &boardPosition)
     {
-        auto mousePosition = GetMousePosition();
-        auto gameStatus = gCoordinator.GetComponent<GameStatus>(game);
-        auto &playerTurn = gCoordinator.GetComponent<PlayerTurn>(game);
+        int index = CellIndex(gameStatus.rules, boardPosition);
+        bool winning = TestCell(gameStatus.winningLine, index);
+        DrawnCell &drawn = mDrawn[index];
+        if (drawn.value == cell.value && drawn.winning == winning)
+        {
+            return;
+        }
 
-        for (auto const &entity : mEntities)
+        if (!mDrawing)
         {
-            auto &cell = gCoordinator.GetComponent<GridCell>(entity);
-            auto &boardPosition = gCoordinator.GetComponent<BoardPosition>(entity);
-
-            if (CheckCollisionPointRec(mousePosition, cell.rect) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
-            {
-                if (cell.value == '-')
-                {
-                    cell.value = playerTurn.symbol;
-                    UpdateGameBoard(game, playerTurn.symbol, boardPosition);
-
-                    playerTurn.symbol = playerTurn.symbol == 'X' ? 'O' : 'X';
-                }
-            }
+            BeginTextureMode(mBoard);
+            mDrawing = true;
         }
+        RenderCell(cell, winning);
+        drawn = DrawnCell{cell.value, winning};
     }
 
-    void CheckResetButtonCollision(Entity game)
+    static void RenderCell(const GridCell &cell, bool winning)
     {
-        auto mousePosition = GetMousePosition();
-        auto &resetButton = gCoordinator.GetComponent<ResetButton>(game);
-
-        if (CheckCollisionPointRec(mousePosition, resetButton.rect) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+        // A quarter of the cell, 50 on the classic 200 pixel cells
+        int textOffset = int(cell.rect.width / 4);
+
+        DrawRectangleRec(ToRectangle(cell.rect), winning ? GREEN : LIGHTGRAY);
+        DrawRectangleLines(cell.rect.x, cell.rect.y, cell.rect.width, cell.rect.height, BLACK);
+        // @FIXME: this is drawing weird characters
+        // DrawText(&cell.value, cell.rect.x + 50, cell.rect.y + 50, 50, BLACK);
+        if (cell.value == 'X')
+        {
+            DrawText("X", cell.rect.x + textOffset, cell.rect.y + textOffset, textOffset, BLACK);
+        }
+        else if (cell.value == 'O')
+        {
+            DrawText("O", cell.rect.x + textOffset, cell.rect.y + textOffset, textOffset, BLACK);
+        }
+        else if (cell.value == '-')
         {
-            auto &gameStatus = gCoordinator.GetComponent<GameStatus>(game);
-            gameStatus = GameStatus{GameStatusEnum::PLAYING, {{'-', '-', '-'}, {'-', '-', '-'}, {'-', '-', '-'}}};
-
-            for (auto const &entity : mEntities)
-            {
-                auto &cell = gCoordinator.GetComponent<GridCell>(entity);
-                cell.value = '-';
-            }
+            DrawText("-", cell.rect.x + textOffset, cell.rect.y + textOffset, textOffset, BLACK);
         }
     }
 
 public:
-    void Update(Entity game)
+#ifdef TRIQUI_PROFILE
+    // Toggled with F3
+    bool mShowProfiler = false;
+#endif
+
+    RenderSystem()
     {
-        auto &gameStatus = gCoordinator.GetComponent<GameStatus>(game);
+        Reads<GridCell, BoardPosition, GameStatus, ResetButton>();
+        // Draws through raylib
+        mMainThreadOnly = true;
+    }
 
-        if (gameStatus.status == GameStatusEnum::PLAYING)
-        {
-            CheckCellCollision(game);
-        }
+    /**
+     * @brief Creates the board texture, needs the window to be open.
+     */
+    void Load(int width, int height, const BoardRules &rules)
+    {
+        mBoard = LoadRenderTexture(width, height);
+        mDrawn.assign(std::size_t(rules.width * rules.height), DrawnCell{});
+        mRedrawAll = true;
 
-        CheckResetButtonCollision(game);
+        BeginTextureMode(mBoard);
+        ClearBackground(RAYWHITE);
+        EndTextureMode();
     }
-};
 
-// Systems
-class RenderSystem : public System
-{
-private:
-    void RenderResetButton(Entity game)
+    /**
+     * @brief Frees the board texture, before the window is closed.
+     */
+    void Unload()
     {
-        auto &resetButton = gCoordinator.GetComponent<ResetButton>(game);
-        DrawRectangleRec(resetButton.rect, RED);
-        DrawText("Reset", resetButton.rect.x + 50, resetButton.rect.y + 50, 50, BLACK);
+        UnloadRenderTexture(mBoard);
+        mBoard = RenderTexture2D{};
     }
 
-public:
     void Update(Entity game)
     {
+        auto &gameStatus = gCoordinator.ReadComponent<GameStatus>(game);
+
+        bool statusChanged = false;
+        gCoordinator.EachChanged<GameStatus>(mChangesSeen, [&](Entity entity)
+                                             { statusChanged |= entity == game; });
+
+        if (statusChanged || mRedrawAll)
+        {
+            gCoordinator.View<GridCell, BoardPosition>().Each([&](Entity, GridCell &cell, BoardPosition &boardPosition)
+                                                              { RedrawCell(gameStatus, cell, boardPosition); });
+        }
+        else
+        {
+            gCoordinator.EachChanged<GridCell>(mChangesSeen, [&](Entity cell)
+                                               { RedrawCell(gameStatus, gCoordinator.ReadComponent<GridCell>(cell), gCoordinator.ReadComponent<BoardPosition>(cell)); });
+        }
+        mChangesSeen = gCoordinator.AdvanceChangeTick();
+        mRedrawAll = false;
+
+        if (mDrawing)
+        {
+            EndTextureMode();
+            mDrawing = false;
+        }
+
         BeginDrawing();
         ClearBackground(RAYWHITE);
 
+        // Render textures are stored upside down
+        DrawTextureRec(mBoard.texture, Rectangle{0.0f, 0.0f, float(mBoard.texture.width), -float(mBoard.texture.height)},
+                       Vector2{0.0f, 0.0f}, WHITE);
         RenderResetButton(game);
-
-        for (auto const &entity : mEntities)
+#ifdef TRIQUI_PROFILE
+        if (mShowProfiler)
         {
-            auto cell = gCoordinator.GetComponent<GridCell>(entity);
-            auto boardPosition = gCoordinator.GetComponent<BoardPosition>(entity);
-
-            auto gameStatus = gCoordinator.GetComponent<GameStatus>(game);
-
-            bool isWinningPosition = false;
-            for (auto winningPosition : gameStatus.winningPositions)
-            {
-                if (winningPosition.row == boardPosition.row && winningPosition.col == boardPosition.col)
-                {
-                    isWinningPosition = true;
-                    break;
-                }
-            }
-
-            DrawRectangleRec(cell.rect, isWinningPosition ? GREEN : LIGHTGRAY);
-            DrawRectangleLines(cell.rect.x, cell.rect.y, cell.rect.width, cell.rect.height, BLACK);
-            // @FIXME: this is drawing weird characters
-            // DrawText(&cell.value, cell.rect.x + 50, cell.rect.y + 50, 50, BLACK);
-            if (cell.value == 'X')
-            {
-                DrawText("X", cell.rect.x + 50, cell.rect.y + 50, 50, BLACK);
-            }
-            else if (cell.value == 'O')
-            {
-                DrawText("O", cell.rect.x + 50, cell.rect.y + 50, 50, BLACK);
-            }
-            else if (cell.value == '-')
-            {
-                DrawText("-", cell.rect.x + 50, cell.rect.y + 50, 50, BLACK);
-            }
+            DrawProfilerOverlay(mBoard.texture.width);
         }
+#endif
 
         EndDrawing();
     }
 };
 
-void CreateCells()
+// Usage: triqui [--ai] [--board width,height,winLength] [--record FILE]
+//
+// --ai plays 'O' with the perfect-play AI on the classic board, and with a one second tree
+// search on other boards. --board picks an m,n,k board such as 15,15,5. --record saves every
+// move and reset of the session for `triqui_headless --replay FILE`.
+//
+// Built with TRIQUI_PROFILE, F3 shows the profiler overlay, --trace FILE writes a Chrome trace
+// and --profile-csv FILE the time of every system per frame.
+int main(int argc, char **argv)
 {
-    for (int row = 0; row < 3; row++)
+    bool ai = false;
+    BoardRules rules = CLASSIC_RULES;
+    const char *recordPath = nullptr;
+
+    for (int i = 1; i < argc; i++)
     {
-        for (int col = 0; col < 3; col++)
+        if (std::strcmp(argv[i], "--ai") == 0)
+        {
+            ai = true;
+        }
+        else if (std::strcmp(argv[i], "--board") == 0 && i + 1 < argc && ParseBoardRules(argv[i + 1], rules))
+        {
+            i++;
+        }
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            recordPath = argv[++i];
+        }
+#ifdef TRIQUI_PROFILE
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc && Profiler::Instance().OpenTrace(argv[i + 1]))
         {
-            auto cell = gCoordinator.CreateEntity();
-            gCoordinator.AddComponent(cell, BoardPosition{row, col});
-            auto x = col * 200.0f;
-            auto y = row * 200.0f;
-            auto width = 200.0f;
-            auto height = 200.0f;
-
-            gCoordinator.AddComponent(cell, GridCell{'-', Rectangle{x, y, width, height}});
+            i++;
+        }
+        else if (std::strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc && Profiler::Instance().OpenCsv(argv[i + 1]))
+        {
+            i++;
+        }
+#endif
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--ai] [--board width,height,winLength] [--record FILE]\n", argv[0]);
+            return 1;
         }
     }
-}
-
-Entity CreateGame()
-{
-    auto game = gCoordinator.CreateEntity();
-    // gCoordinator.AddComponent(game, GameStatus{GameStatusEnum::PLAYING, {}});
-    gCoordinator.AddComponent(game, GameStatus{GameStatusEnum::PLAYING, {{'-', '-', '-'}, {'-', '-', '-'}, {'-', '-', '-'}}});
-    gCoordinator.AddComponent(game, PlayerTurn{'X'});
-    gCoordinator.AddComponent(game, ResetButton{Rectangle{600, 400, 200, 100}});
-
-    return game;
-}
 
-int main()
-{
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE);
     InitWindow(800, 600, "Triki!");
 
+    ThreadPool threadPool;
+
     gCoordinator.Init();
-    gCoordinator.RegisterComponent<BoardPosition>();
-    gCoordinator.RegisterComponent<GridCell>();
-    gCoordinator.RegisterComponent<GameStatus>();
-    gCoordinator.RegisterComponent<PlayerTurn>();
-    gCoordinator.RegisterComponent<ResetButton>();
+    std::shared_ptr<InputSystem> inputSystem;
+    std::shared_ptr<GameSystem> gameSystem;
+    RegisterGame(inputSystem, gameSystem);
+    inputSystem->SetInputSource(std::make_shared<MouseMoveSource>(inputSystem->Layout()));
+    // Reads the mouse through raylib
+    inputSystem->mMainThreadOnly = true;
+    if (ai && rules.width == 3 && rules.height == 3 && rules.winLength == 3)
+    {
+        inputSystem->SetPlayerSource('O', std::make_shared<PerfectMoveSource>());
+    }
+    else if (ai)
+    {
+        MctsConfig config;
+        config.limits = MctsLimits{1.0, 0};
+        inputSystem->SetPlayerSource('O', std::make_shared<MctsMoveSource>(threadPool, config));
+    }
+
+    std::shared_ptr<InputLog> recorder;
+    if (recordPath != nullptr)
+    {
+        recorder = std::make_shared<InputLog>(rules);
+        inputSystem->SetRecorder(recorder);
+    }
 
     auto renderSystem = gCoordinator.RegisterSystem<RenderSystem>();
-    auto inputSystem = gCoordinator.RegisterSystem<InputSystem>();
-    auto gameSystem = gCoordinator.RegisterSystem<GameSystem>();
 
     Signature renderSystemSignature;
     renderSystemSignature.set(gCoordinator.GetComponentType<GridCell>());
     gCoordinator.SetSystemSignature<RenderSystem>(renderSystemSignature);
-    gCoordinator.SetSystemSignature<InputSystem>(renderSystemSignature);
 
-    auto game = CreateGame();
-    CreateCells();
+    auto game = CreateGame(rules);
+    CreateCells(rules);
+    renderSystem->Load(600, 600, rules);
+
+    Scheduler scheduler;
+    scheduler.Add(inputSystem, [&]
+                  { inputSystem->Update(game); },
+                  "InputSystem::Update");
+    scheduler.Add(gameSystem, [&]
+                  { gameSystem->Update(threadPool); },
+                  "GameSystem::Update");
+    scheduler.Add(renderSystem, [&]
+                  { renderSystem->Update(game); },
+                  "RenderSystem::Update");
 
     while (!WindowShouldClose())
     {
-        inputSystem->Update(game);
-        gameSystem->Update(game);
-        renderSystem->Update(game);
+        if (IsWindowResized())
+        {
+            int side = LayoutWindow(game, rules);
+            // The cells moved, clicks find them through a new layout on a new texture
+            inputSystem->InvalidateLayout();
+            renderSystem->Unload();
+            renderSystem->Load(side, side, rules);
+        }
+
+        scheduler.Run(threadPool);
+        // Sync point, structural changes recorded during the frame are applied here
+        gCoordinator.FlushCommands();
+
+#ifdef TRIQUI_PROFILE
+        PROFILE_COUNTER("entities", gCoordinator.GetLivingEntityCount());
+        PROFILE_COUNTER("GridCell components", CountComponents<GridCell>());
+        PROFILE_COUNTER("GameStatus components", CountComponents<GameStatus>());
+        PROFILE_FRAME();
+        if (IsKeyPressed(KEY_F3))
+        {
+            renderSystem->mShowProfiler = !renderSystem->mShowProfiler;
+        }
+#endif
+
+        // Sleep until the next input event unless the AI has a move to make
+        auto &gameStatus = gCoordinator.ReadComponent<GameStatus>(game);
+        bool aiToMove = ai && gameStatus.status == GameStatusEnum::PLAYING && gCoordinator.ReadComponent<PlayerTurn>(game).symbol == 'O';
+        if (aiToMove)
+        {
+            DisableEventWaiting();
+        }
+        else
+        {
+            EnableEventWaiting();
+        }
     }
 
+    renderSystem->Unload();
     CloseWindow();
+
+    if (recorder != nullptr && !recorder->Save(recordPath))
+    {
+        std::fprintf(stderr, "cannot write input log %s\n", recordPath);
+        return 1;
+    }
 }
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// The wire protocol of triqui_server and triqui_loadgen. Every message is MATCH_MESSAGE_SIZE
+// bytes, so a receiver decodes whole messages where they landed in its buffer and a sender
+// encodes them straight into its output buffer.
+//
+// A client sends JOIN to queue for a match. The server pairs clients in the order they joined
+// and sends each a START with its symbol. The player to move sends MOVE; the server checks it
+// against the match's GameStatus and echoes it to both players as MOVED, or answers REJECTED.
+// When the game ends both players get OVER and may JOIN again.
+
+constexpr std::size_t MATCH_MESSAGE_SIZE = 8;
+constexpr std::uint16_t DEFAULT_MATCH_PORT = 7878;
+
+enum class MatchMessageType : std::uint8_t
+{
+    // Client: queue for the next match
+    JOIN = 1,
+    // Client: mark (row, col), sequence comes back in the MOVED echo
+    MOVE,
+    // Server: a match started, symbol is the client's, row and col are the board width and
+    // height and sequence the win length
+    START,
+    // Server, to both players: symbol marked (row, col), sequence is the mover's
+    MOVED,
+    // Server, to the mover: the move numbered sequence was not legal
+    REJECTED,
+    // Server, to both players: symbol is the winner or '-' for a draw, row is 1 when the
+    // opponent left
+    OVER
+};
+
+/**
+ * @brief One message: four bytes, then the sequence number little-endian.
+ */
+struct MatchMessage
+{
+    MatchMessageType type;
+    char symbol;
+    std::uint8_t row;
+    std::uint8_t col;
+    std::uint32_t sequence;
+};
+
+inline void EncodeMatchMessage(const MatchMessage &message, std::uint8_t *bytes)
+{
+    bytes[0] = static_cast<std::uint8_t>(message.type);
+    bytes[1] = static_cast<std::uint8_t>(message.symbol);
+    bytes[2] = message.row;
+    bytes[3] = message.col;
+    for (int i = 0; i < 4; i++)
+    {
+        bytes[4 + i] = static_cast<std::uint8_t>(message.sequence >> (8 * i));
+    }
+}
+
+inline MatchMessage DecodeMatchMessage(const std::uint8_t *bytes)
+{
+    MatchMessage message{static_cast<MatchMessageType>(bytes[0]), static_cast<char>(bytes[1]), bytes[2], bytes[3], 0};
+    for (int i = 0; i < 4; i++)
+    {
+        message.sequence |= std::uint32_t(bytes[4 + i]) << (8 * i);
+    }
+
+    return message;
+}
+
+/**
+ * @brief A connection's buffers: received bytes not yet decoded and encoded messages not yet
+ * sent. Both are fixed arrays, nothing is copied between receiving and decoding or between
+ * encoding and sending.
+ */
+struct MatchBuffers
+{
+    static constexpr std::size_t CAPACITY = 4096;
+
+    std::uint8_t input[CAPACITY];
+    std::size_t inputSize = 0;
+    std::uint8_t output[CAPACITY];
+    std::size_t outputBegin = 0;
+    std::size_t outputEnd = 0;
+
+    void Clear()
+    {
+        inputSize = 0;
+        outputBegin = 0;
+        outputEnd = 0;
+    }
+
+    /**
+     * @brief Receives what fits and calls `handle` with every whole message, a partial one
+     * stays for the next call.
+     *
+     * @return false when the peer closed the connection or it failed.
+     */
+    template <typename Handle>
+    bool Receive(int socket, Handle &&handle)
+    {
+        ssize_t received = ::recv(socket, input + inputSize, CAPACITY - inputSize, 0);
+        if (received <= 0)
+        {
+            return received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+        }
+        inputSize += std::size_t(received);
+
+        std::size_t offset = 0;
+        for (; offset + MATCH_MESSAGE_SIZE <= inputSize; offset += MATCH_MESSAGE_SIZE)
+        {
+            if (!handle(DecodeMatchMessage(input + offset)))
+            {
+                return false;
+            }
+        }
+
+        // At most MATCH_MESSAGE_SIZE - 1 bytes move to the front
+        std::memmove(input, input + offset, inputSize - offset);
+        inputSize -= offset;
+        return true;
+    }
+
+    /**
+     * @brief Encodes the message after the ones waiting to be sent.
+     *
+     * @return false when the buffer is full, the peer is not reading.
+     */
+    bool Push(const MatchMessage &message)
+    {
+        if (outputEnd + MATCH_MESSAGE_SIZE > CAPACITY)
+        {
+            std::memmove(output, output + outputBegin, outputEnd - outputBegin);
+            outputEnd -= outputBegin;
+            outputBegin = 0;
+            if (outputEnd + MATCH_MESSAGE_SIZE > CAPACITY)
+            {
+                return false;
+            }
+        }
+
+        EncodeMatchMessage(message, output + outputEnd);
+        outputEnd += MATCH_MESSAGE_SIZE;
+        return true;
+    }
+
+    bool Pending() const
+    {
+        return outputBegin != outputEnd;
+    }
+
+    /**
+     * @brief Sends what the socket takes of the waiting messages.
+     *
+     * @return false when the connection failed.
+     */
+    bool Flush(int socket)
+    {
+        while (outputBegin != outputEnd)
+        {
+            ssize_t sent = ::send(socket, output + outputBegin, outputEnd - outputBegin, MSG_NOSIGNAL);
+            if (sent < 0)
+            {
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            }
+            outputBegin += std::size_t(sent);
+        }
+
+        outputBegin = 0;
+        outputEnd = 0;
+        return true;
+    }
+};
+
+// Socket setup shared by the server and the load generator
+
+inline bool SetNonBlocking(int socket)
+{
+    int flags = ::fcntl(socket, F_GETFL, 0);
+    return flags >= 0 && ::fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/**
+ * @brief Lifts the soft limit on open files to the hard one, a socket per player adds up.
+ */
+inline void RaiseFileLimit()
+{
+    rlimit limit;
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+inline bool FillTcpAddress(const char *host, std::uint16_t port, sockaddr_in &address)
+{
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    return ::inet_pton(AF_INET, host, &address.sin_addr) == 1;
+}
+
+inline bool FillUnixAddress(const char *path, sockaddr_un &address)
+{
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+
+    std::strcpy(address.sun_path, path);
+    return true;
+}
@@ -0,0 +1,267 @@
+#include "mcts.h"
+
+#include <cmath>
+
+namespace
+{
+    constexpr int MAX_CELLS = MAX_BOARD_SIDE * MAX_BOARD_SIDE;
+
+    // xorshift64*, the playouts call it for every move so it has to be cheap
+    std::uint64_t NextRandom(std::uint64_t &state)
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
+    }
+}
+
+MctsEngine::MctsEngine(ThreadPool &pool, const MctsConfig &config)
+    : mPool(pool), mConfig(config), mNodes(new Node[config.nodeCapacity])
+{
+    assert(config.nodeCapacity > 1 && "The arena needs room for the root and its children.");
+    assert(config.virtualLoss > 0 && "The virtual loss counts the thread's own visit.");
+}
+
+bool MctsEngine::Expand(std::uint32_t index, const Position &position)
+{
+    Node &node = mNodes[index];
+
+    std::uint32_t expected = 0;
+    if (!node.children.compare_exchange_strong(expected, EXPANDING, std::memory_order_acquire))
+    {
+        // Someone else expanded it, or is still at it
+        return expected != EXPANDING;
+    }
+
+    int cells = position.rules->width * position.rules->height;
+    std::uint32_t count = std::uint32_t(cells - position.moveCount);
+
+    // A full arena leaves the node claimed forever, it stays a leaf that playouts start from
+    if (mNodeCount.load(std::memory_order_relaxed) + count > mConfig.nodeCapacity)
+    {
+        return false;
+    }
+    std::uint32_t first = mNodeCount.fetch_add(count, std::memory_order_relaxed);
+    if (first + count > mConfig.nodeCapacity)
+    {
+        return false;
+    }
+
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        Node &child = mNodes[first + i];
+        child.visits.store(0, std::memory_order_relaxed);
+        child.score.store(0, std::memory_order_relaxed);
+        child.children.store(0, std::memory_order_relaxed);
+        child.childCount = 0;
+        child.move = std::int16_t(NthEmptyCell(*position.rules, position.marks, int(i)));
+    }
+
+    // Publishes the children, readers acquire it before they look at childCount and the moves
+    node.childCount = std::uint16_t(count);
+    node.children.store(first, std::memory_order_release);
+
+    return true;
+}
+
+std::uint32_t MctsEngine::Select(const Node &node) const
+{
+    std::uint32_t first = node.children.load(std::memory_order_acquire);
+    double logVisits = std::log(double(std::max<std::uint32_t>(node.visits.load(std::memory_order_relaxed), 1)));
+
+    std::uint32_t best = first;
+    double bestValue = -1.0;
+    for (std::uint32_t i = first; i < first + node.childCount; i++)
+    {
+        const Node &child = mNodes[i];
+        std::uint32_t visits = child.visits.load(std::memory_order_relaxed);
+        if (visits == 0)
+        {
+            return i;
+        }
+
+        double score = child.score.load(std::memory_order_relaxed);
+        double value = score / (2.0 * visits) + mConfig.exploration * std::sqrt(logVisits / visits);
+        if (value > bestValue)
+        {
+            bestValue = value;
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+int MctsEngine::Playout(Position &position, std::uint64_t &random)
+{
+    const BoardRules &rules = *position.rules;
+    int cells = rules.width * rules.height;
+
+    while (position.moveCount < cells)
+    {
+        int cell = NthEmptyCell(rules, position.marks, int(NextRandom(random) % std::uint64_t(cells - position.moveCount)));
+        SetCell(position.marks[position.toMove], cell);
+        position.moveCount++;
+
+        if (CompletesLine(rules, position.marks[position.toMove], cell))
+        {
+            return position.toMove;
+        }
+        position.toMove ^= 1;
+    }
+
+    return -1;
+}
+
+void MctsEngine::Work(const Position &root, std::uint64_t seed, std::chrono::steady_clock::time_point deadline)
+{
+    std::uint64_t random = seed * 0x9E3779B97F4A7C15ULL + 1;
+    std::uint32_t path[MAX_CELLS + 1];
+    int cells = root.rules->width * root.rules->height;
+    std::uint32_t virtualLoss = mConfig.virtualLoss;
+
+    for (std::uint64_t iteration = 0; !mStop.load(std::memory_order_relaxed); iteration++)
+    {
+        Position position = root;
+        int depth = 0;
+        std::uint32_t index = 0;
+        path[depth++] = index;
+        mNodes[index].visits.fetch_add(virtualLoss, std::memory_order_relaxed);
+
+        // Selection and expansion
+        while (position.winner < 0 && position.moveCount < cells)
+        {
+            Node &node = mNodes[index];
+            std::uint32_t children = node.children.load(std::memory_order_acquire);
+            // Visits counts this thread's virtual loss, the other visits are mostly finished ones
+            if (children == 0 && node.visits.load(std::memory_order_relaxed) + 1 >= mConfig.expandVisits + virtualLoss)
+            {
+                Expand(index, position);
+                children = node.children.load(std::memory_order_acquire);
+            }
+            if (children == 0 || children == EXPANDING)
+            {
+                break;
+            }
+
+            index = Select(node);
+            Node &child = mNodes[index];
+            child.visits.fetch_add(virtualLoss, std::memory_order_relaxed);
+            path[depth++] = index;
+
+            SetCell(position.marks[position.toMove], child.move);
+            position.moveCount++;
+            if (CompletesLine(*position.rules, position.marks[position.toMove], child.move))
+            {
+                position.winner = position.toMove;
+            }
+            position.toMove ^= 1;
+        }
+
+        int winner = position.winner >= 0 ? position.winner : Playout(position, random);
+
+        // Backup, turning the virtual losses back into one real visit per node
+        for (int i = 0; i < depth; i++)
+        {
+            Node &node = mNodes[path[i]];
+            if (virtualLoss > 1)
+            {
+                node.visits.fetch_sub(virtualLoss - 1, std::memory_order_relaxed);
+            }
+
+            // The root has no move into it, node i was played by the side to move at depth i - 1
+            int mover = (root.toMove + i - 1) & 1;
+            if (i > 0 && winner != 1 - mover)
+            {
+                node.score.fetch_add(winner == mover ? 2 : 1, std::memory_order_relaxed);
+            }
+        }
+
+        std::uint64_t playouts = mPlayouts.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (mConfig.limits.playouts != 0 && playouts >= mConfig.limits.playouts)
+        {
+            mStop.store(true, std::memory_order_relaxed);
+        }
+        if (mConfig.limits.seconds > 0.0 && iteration % 64 == 0 && std::chrono::steady_clock::now() >= deadline)
+        {
+            mStop.store(true, std::memory_order_relaxed);
+        }
+    }
+}
+
+int MctsEngine::Search(const GameStatus &gameStatus, int toMove, MctsStats *stats)
+{
+    assert((mConfig.limits.seconds > 0.0 || mConfig.limits.playouts > 0) && "A search needs a time or playout limit.");
+
+    if (gameStatus.status != GameStatusEnum::PLAYING || EmptyCellCount(gameStatus) == 0)
+    {
+        return -1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Reuse the arena, only the root has to be reset
+    Node &root = mNodes[0];
+    root.visits.store(0, std::memory_order_relaxed);
+    root.score.store(0, std::memory_order_relaxed);
+    root.children.store(0, std::memory_order_relaxed);
+    mNodeCount.store(1, std::memory_order_relaxed);
+    mPlayouts.store(0, std::memory_order_relaxed);
+    mStop.store(false, std::memory_order_relaxed);
+
+    Position position{&gameStatus.rules, {gameStatus.marks[0], gameStatus.marks[1]}, gameStatus.moveCount, toMove, -1};
+    bool expanded = Expand(0, position);
+    assert(expanded && "The arena is too small for the root's children.");
+    (void)expanded;
+
+    auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(mConfig.limits.seconds));
+    std::size_t threads = mConfig.threads != 0 ? mConfig.threads : mPool.ThreadCount() + 1;
+    std::uint64_t seed = std::uint64_t(mConfig.seed) + std::uint64_t(mSearches++) * threads;
+
+    TaskGroup group;
+    for (std::size_t i = 1; i < threads; i++)
+    {
+        mPool.Submit([this, &position, seed, i, deadline]
+                     { Work(position, seed + i, deadline); },
+                     &group);
+    }
+    Work(position, seed, deadline);
+    mPool.Wait(group);
+
+    std::uint32_t first = root.children.load(std::memory_order_relaxed);
+    std::uint32_t best = first;
+    for (std::uint32_t i = first; i < first + root.childCount; i++)
+    {
+        if (mNodes[i].visits.load(std::memory_order_relaxed) > mNodes[best].visits.load(std::memory_order_relaxed))
+        {
+            best = i;
+        }
+    }
+
+    if (stats != nullptr)
+    {
+        stats->playouts = mPlayouts.load(std::memory_order_relaxed);
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stats->nodes = std::min(mNodeCount.load(std::memory_order_relaxed), mConfig.nodeCapacity);
+    }
+
+    return mNodes[best].move;
+}
+
+MctsMoveSource::MctsMoveSource(ThreadPool &pool, const MctsConfig &config)
+    : mEngine(pool, config)
+{
+}
+
+int MctsMoveSource::ChooseCell(const GameStatus &gameStatus, int toMove)
+{
+    MctsStats stats;
+    int cell = mEngine.Search(gameStatus, toMove, &stats);
+
+    mTotal.playouts += stats.playouts;
+    mTotal.seconds += stats.seconds;
+    mTotal.nodes = std::max(mTotal.nodes, stats.nodes);
+
+    return cell;
+}
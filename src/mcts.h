@@ -0,0 +1,145 @@
+#pragma once
+
+#include "game.h"
+#include "thread-pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @brief When a search stops, 0 leaves that limit out. At least one limit has to be set.
+ */
+struct MctsLimits
+{
+    double seconds = 0.0;
+    std::uint64_t playouts = 0;
+};
+
+struct MctsConfig
+{
+    MctsLimits limits{0.0, 10000};
+    // Nodes of the preallocated tree arena, expansion stops once it is full
+    std::uint32_t nodeCapacity = 1u << 21;
+    // Visits a leaf needs before it gets children, higher values save arena space on big boards
+    std::uint32_t expandVisits = 2;
+    // Visits (all losses) a thread adds to every node on its path until it backs up its result
+    std::uint32_t virtualLoss = 3;
+    // UCT exploration constant
+    double exploration = 1.4;
+    // Threads searching the same tree, 0 uses every pool thread plus the calling thread
+    std::size_t threads = 0;
+    std::uint32_t seed = 1;
+};
+
+struct MctsStats
+{
+    std::uint64_t playouts = 0;
+    double seconds = 0.0;
+    std::uint32_t nodes = 0;
+
+    double PlayoutsPerSecond() const
+    {
+        return seconds > 0.0 ? playouts / seconds : 0.0;
+    }
+};
+
+/**
+ * @brief Monte Carlo Tree Search for m,n,k boards, with tree parallelism.
+ *
+ * Every thread walks the same tree: it selects children by UCT, expands a leaf, plays a random
+ * game from it on a copy of the bitboards and backs the result up the path. Nodes come from an
+ * arena allocated once; a thread claims a leaf's expansion with a compare-and-swap and
+ * publishes its children with a release store, so the tree never takes a lock. Virtual losses
+ * on the path steer other threads away from the line a thread is already exploring.
+ */
+class GAME_EXPORT MctsEngine
+{
+private:
+    struct Node
+    {
+        // Visits, including the virtual losses of threads that are below this node
+        std::atomic<std::uint32_t> visits{0};
+        // 2 per win and 1 per draw, for the player who made the move into this node
+        std::atomic<std::uint32_t> score{0};
+        // Arena index of the first child, 0 before expansion, EXPANDING while it is claimed
+        std::atomic<std::uint32_t> children{0};
+        std::uint16_t childCount = 0;
+        std::int16_t move = -1;
+    };
+
+    static constexpr std::uint32_t EXPANDING = ~0u;
+
+    ThreadPool &mPool;
+    MctsConfig mConfig;
+    std::unique_ptr<Node[]> mNodes;
+    std::atomic<std::uint32_t> mNodeCount{0};
+
+    // Per-search state shared by the threads
+    std::atomic<std::uint64_t> mPlayouts{0};
+    std::atomic<bool> mStop{false};
+    std::uint32_t mSearches = 0;
+
+    struct Position
+    {
+        const BoardRules *rules;
+        Bitboard marks[2];
+        int moveCount;
+        int toMove;
+        // 0 or 1 once someone has won, -1 otherwise
+        int winner;
+    };
+
+    void Work(const Position &root, std::uint64_t seed, std::chrono::steady_clock::time_point deadline);
+    bool Expand(std::uint32_t index, const Position &position);
+    std::uint32_t Select(const Node &node) const;
+    static int Playout(Position &position, std::uint64_t &random);
+
+public:
+    MctsEngine(ThreadPool &pool, const MctsConfig &config = MctsConfig{});
+
+    MctsEngine(const MctsEngine &) = delete;
+    MctsEngine &operator=(const MctsEngine &) = delete;
+
+    const MctsConfig &Config() const
+    {
+        return mConfig;
+    }
+
+    void SetLimits(const MctsLimits &limits)
+    {
+        mConfig.limits = limits;
+    }
+
+    /**
+     * @brief Searches the position for `toMove` (0 for 'X', 1 for 'O') and returns the most
+     * visited cell.
+     *
+     * @return -1 when the game is over or the board is full.
+     */
+    int Search(const GameStatus &gameStatus, int toMove, MctsStats *stats = nullptr);
+};
+
+/**
+ * @brief Plays the moves of an MctsEngine and keeps count of its playouts for reports.
+ */
+class GAME_EXPORT MctsMoveSource : public EngineMoveSource
+{
+private:
+    MctsEngine mEngine;
+    MctsStats mTotal{};
+
+public:
+    MctsMoveSource(ThreadPool &pool, const MctsConfig &config = MctsConfig{});
+
+    int ChooseCell(const GameStatus &gameStatus, int toMove) override;
+
+    /**
+     * @brief Playouts and search time summed over every move so far.
+     */
+    const MctsStats &Total() const
+    {
+        return mTotal;
+    }
+};
@@ -0,0 +1,343 @@
+#include "perfect-play.h"
+
+#include <array>
+#include <cstdint>
+
+// Compile-time solve of the 3x3 game.
+//
+// Negamax with alpha-beta over the game tree, with a transposition table shared by the 8
+// rotations and reflections of each position. The solver then walks every reachable position
+// and records the best move in a table indexed by the base-3 encoding of the board
+// (cell digit 0 empty, 1 'X', 2 'O'), so looking up a move at runtime is a single index.
+
+namespace
+{
+    constexpr int POSITIONS = 19683; // 3^9
+
+    constexpr int POW3[9] = {1, 3, 9, 27, 81, 243, 729, 2187, 6561};
+
+    // Cell index mapping of the 8 symmetries of the board
+    constexpr int SYMMETRIES[8][9] = {
+        {0, 1, 2, 3, 4, 5, 6, 7, 8},  // identity
+        {6, 3, 0, 7, 4, 1, 8, 5, 2},  // rotate 90
+        {8, 7, 6, 5, 4, 3, 2, 1, 0},  // rotate 180
+        {2, 5, 8, 1, 4, 7, 0, 3, 6},  // rotate 270
+        {2, 1, 0, 5, 4, 3, 8, 7, 6},  // mirror columns
+        {6, 7, 8, 3, 4, 5, 0, 1, 2},  // mirror rows
+        {0, 3, 6, 1, 4, 7, 2, 5, 8},  // main diagonal
+        {8, 5, 2, 7, 4, 1, 6, 3, 0}}; // anti diagonal
+
+    constexpr std::array<std::array<int, 9>, 8> BuildInverseSymmetries()
+    {
+        std::array<std::array<int, 9>, 8> inverse{};
+        for (int s = 0; s < 8; s++)
+        {
+            for (int cell = 0; cell < 9; cell++)
+            {
+                inverse[s][SYMMETRIES[s][cell]] = cell;
+            }
+        }
+
+        return inverse;
+    }
+
+    constexpr std::array<std::array<int, 9>, 8> INVERSE_SYMMETRIES = BuildInverseSymmetries();
+
+    // Center, corners, then edges, the strongest moves first gives the most cutoffs
+    constexpr int MOVE_ORDER[9] = {4, 0, 2, 6, 8, 1, 3, 5, 7};
+
+    // Every 9-bit mask under each symmetry, so canonicalizing a position is 16 lookups. Each
+    // mask extends the one without its highest cell, which keeps the compile-time cost low.
+    constexpr std::array<std::array<BoardMask, 512>, 8> BuildSymmetricMasks()
+    {
+        std::array<std::array<BoardMask, 512>, 8> masks{};
+        int high = 0;
+        for (int mask = 1; mask < 512; mask++)
+        {
+            if (mask == 2 << high)
+            {
+                high++;
+            }
+
+            for (int s = 0; s < 8; s++)
+            {
+                masks[s][mask] = BoardMask(masks[s][mask ^ (1 << high)] | 1 << SYMMETRIES[s][high]);
+            }
+        }
+
+        return masks;
+    }
+
+    constexpr std::array<std::array<BoardMask, 512>, 8> SYMMETRIC_MASKS = BuildSymmetricMasks();
+
+    // Per 9-bit mask: its base-3 digits as if every set cell held 1, whether it holds a win
+    // line, and its number of marks. The solver runs at compile time, where every operation
+    // counts against the compiler's limits, so it looks these up instead of looping over cells.
+    struct MaskInfo
+    {
+        std::array<int, 512> base3{};
+        std::array<bool, 512> hasLine{};
+        std::array<int, 512> bits{};
+    };
+
+    constexpr MaskInfo BuildMaskInfo()
+    {
+        MaskInfo info{};
+        int high = 0;
+        for (int mask = 1; mask < 512; mask++)
+        {
+            if (mask == 2 << high)
+            {
+                high++;
+            }
+
+            int rest = mask ^ (1 << high);
+            info.base3[mask] = info.base3[rest] + POW3[high];
+            info.bits[mask] = info.bits[rest] + 1;
+
+            for (BoardMask line : WIN_LINES)
+            {
+                info.hasLine[mask] = info.hasLine[mask] || (mask & line) == line;
+            }
+        }
+
+        return info;
+    }
+
+    constexpr MaskInfo MASK_INFO = BuildMaskInfo();
+
+    constexpr int Index(BoardMask x, BoardMask o)
+    {
+        return MASK_INFO.base3[x] + 2 * MASK_INFO.base3[o];
+    }
+
+    enum Bound : std::uint8_t
+    {
+        NONE,
+        EXACT,
+        LOWER,
+        UPPER
+    };
+
+    struct Entry
+    {
+        std::int8_t value;
+        Bound bound;
+        // Best cell + 1 of the canonical position, 0 until solved
+        std::int8_t move;
+    };
+
+    // The smallest image of a position under the 8 symmetries, and the symmetry that gives it
+    struct Canonical
+    {
+        BoardMask x;
+        BoardMask o;
+        int symmetry;
+    };
+
+    constexpr Canonical Canonicalize(BoardMask x, BoardMask o)
+    {
+        Canonical canonical{x, o, 0};
+        std::uint32_t best = x | std::uint32_t(o) << 9;
+        for (int s = 1; s < 8; s++)
+        {
+            std::uint32_t key = SYMMETRIC_MASKS[s][x] | std::uint32_t(SYMMETRIC_MASKS[s][o]) << 9;
+            if (key < best)
+            {
+                best = key;
+                canonical = Canonical{SYMMETRIC_MASKS[s][x], SYMMETRIC_MASKS[s][o], s};
+            }
+        }
+
+        return canonical;
+    }
+
+    constexpr bool IsOver(BoardMask x, BoardMask o)
+    {
+        return MASK_INFO.hasLine[x] || MASK_INFO.hasLine[o] || (x | o) == FULL_BOARD;
+    }
+
+    class Solver
+    {
+    private:
+        // Transposition table keyed by the base-3 index of the canonical position
+        std::array<Entry, POSITIONS> mTable{};
+
+        constexpr Entry &Lookup(BoardMask own, BoardMask other)
+        {
+            // The key is always X then O, whoever is to move
+            bool xToMove = MASK_INFO.bits[own] == MASK_INFO.bits[other];
+            Canonical canonical = xToMove ? Canonicalize(own, other) : Canonicalize(other, own);
+
+            return mTable[Index(canonical.x, canonical.o)];
+        }
+
+    public:
+        /**
+         * @brief Score for the player to move (`own`): positive wins, negative loses, faster is bigger.
+         */
+        constexpr int Search(BoardMask own, BoardMask other, int alpha, int beta)
+        {
+            int empty = 9 - MASK_INFO.bits[own | other];
+            if (MASK_INFO.hasLine[other])
+            {
+                return -(empty + 1);
+            }
+            if (empty == 0)
+            {
+                return 0;
+            }
+
+            Entry &entry = Lookup(own, other);
+            if (entry.bound == EXACT)
+            {
+                return entry.value;
+            }
+            if (entry.bound == LOWER && entry.value > alpha)
+            {
+                alpha = entry.value;
+            }
+            else if (entry.bound == UPPER && entry.value < beta)
+            {
+                beta = entry.value;
+            }
+            if (entry.bound != NONE && alpha >= beta)
+            {
+                return entry.value;
+            }
+
+            int originalAlpha = alpha;
+            int best = -100;
+            for (int cell : MOVE_ORDER)
+            {
+                BoardMask bit = BoardMask(1u << cell);
+                if ((own | other) & bit)
+                {
+                    continue;
+                }
+
+                int value = -Search(other, BoardMask(own | bit), -beta, -alpha);
+                if (value > best)
+                {
+                    best = value;
+                }
+                if (best > alpha)
+                {
+                    alpha = best;
+                }
+                if (alpha >= beta)
+                {
+                    break;
+                }
+            }
+
+            entry.value = std::int8_t(best);
+            entry.bound = best <= originalAlpha ? UPPER : best >= beta ? LOWER
+                                                                       : EXACT;
+
+            return best;
+        }
+
+        /**
+         * @brief Returns the best cell of a canonical position that is not over, solving it once.
+         */
+        constexpr int BestMove(BoardMask x, BoardMask o)
+        {
+            bool xToMove = MASK_INFO.bits[x] == MASK_INFO.bits[o];
+            BoardMask own = xToMove ? x : o;
+            BoardMask other = xToMove ? o : x;
+
+            Entry &entry = mTable[Index(x, o)];
+            if (entry.move != 0)
+            {
+                return entry.move - 1;
+            }
+
+            // Root of an alpha-beta search, a move only has to prove it beats the best so far
+            int alpha = -100;
+            int bestCell = -1;
+            for (int cell : MOVE_ORDER)
+            {
+                BoardMask bit = BoardMask(1u << cell);
+                if ((own | other) & bit)
+                {
+                    continue;
+                }
+
+                int value = -Search(other, BoardMask(own | bit), -100, -alpha);
+                if (value > alpha)
+                {
+                    alpha = value;
+                    bestCell = cell;
+                }
+            }
+
+            // Search may have written the entry through another reference, index it again
+            mTable[Index(x, o)].move = std::int8_t(bestCell + 1);
+
+            return bestCell;
+        }
+    };
+
+    // Best cell + 1 of every position by base-3 index, 0 when the game is over or unreachable
+    struct MoveTable
+    {
+        std::array<std::int8_t, POSITIONS> moves{};
+    };
+
+    constexpr void Fill(Solver &solver, MoveTable &table, BoardMask x, BoardMask o)
+    {
+        int index = Index(x, o);
+        if (table.moves[index] != 0 || IsOver(x, o))
+        {
+            return;
+        }
+
+        // Solve the canonical position and map its move back through the inverse symmetry
+        Canonical canonical = Canonicalize(x, o);
+        int move = solver.BestMove(canonical.x, canonical.o);
+        table.moves[index] = std::int8_t(INVERSE_SYMMETRIES[canonical.symmetry][move] + 1);
+
+        bool xToMove = MASK_INFO.bits[x] == MASK_INFO.bits[o];
+        for (BoardMask empty = FULL_BOARD & ~(x | o); empty != 0; empty &= empty - 1)
+        {
+            BoardMask bit = empty & -empty;
+            if (xToMove)
+            {
+                Fill(solver, table, BoardMask(x | bit), o);
+            }
+            else
+            {
+                Fill(solver, table, x, BoardMask(o | bit));
+            }
+        }
+    }
+
+    constexpr MoveTable Solve()
+    {
+        Solver solver{};
+        MoveTable table{};
+        Fill(solver, table, 0, 0);
+
+        return table;
+    }
+
+    constexpr MoveTable MOVE_TABLE = Solve();
+}
+
+int PerfectMove(BoardMask xMarks, BoardMask oMarks)
+{
+    return MOVE_TABLE.moves[Index(xMarks, oMarks)] - 1;
+}
+
+int PerfectMoveSource::ChooseCell(const GameStatus &gameStatus, int)
+{
+    const BoardRules &rules = gameStatus.rules;
+    if (rules.width != 3 || rules.height != 3 || rules.winLength != 3)
+    {
+        return -1;
+    }
+
+    // A 3x3 board lives in the low 9 bits of the first word
+    return PerfectMove(BoardMask(gameStatus.marks[0].words[0]), BoardMask(gameStatus.marks[1].words[0]));
+}
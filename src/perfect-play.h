@@ -0,0 +1,32 @@
+#pragma once
+
+#include "game.h"
+
+// 3x3 board bitmask, bit row * 3 + col is the cell at (row, col)
+using BoardMask = std::uint16_t;
+
+constexpr BoardMask FULL_BOARD = 0x1FF;
+
+// Rows, columns and both diagonals
+constexpr BoardMask WIN_LINES[8] = {
+    0x007, 0x038, 0x1C0,
+    0x049, 0x092, 0x124,
+    0x111, 0x054};
+
+/**
+ * @brief Plays the 3x3 game perfectly, it never loses and wins as fast as it can.
+ *
+ * The best move of every reachable position is solved at compile time, see perfect-play.cpp,
+ * so ChooseCell only turns the board into a table index. It can play either side, the window and
+ * triqui_headless use it for 'O'. It only knows the classic 3,3,3 game and passes on other boards.
+ */
+class GAME_EXPORT PerfectMoveSource : public EngineMoveSource
+{
+public:
+    int ChooseCell(const GameStatus &gameStatus, int toMove) override;
+};
+
+/**
+ * @brief Returns the best cell index (row * 3 + col) for the player to move, -1 when the game is over.
+ */
+GAME_EXPORT int PerfectMove(BoardMask xMarks, BoardMask oMarks);
@@ -0,0 +1,421 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#define PROFILER_EXPORT __declspec(dllexport)
+#else
+#define PROFILER_EXPORT
+#endif
+
+/**
+ * @brief One timed scope or counter sample, names are string literals.
+ */
+struct PROFILER_EXPORT ProfileEvent
+{
+    const char *name;
+    // Nanoseconds since the profiler started
+    std::uint64_t start;
+    std::uint64_t duration;
+    std::int64_t value;
+    bool counter;
+};
+
+/**
+ * @brief Events of one thread. Only its thread appends, so recording never takes a lock.
+ */
+class PROFILER_EXPORT ProfileBuffer
+{
+public:
+    // Events a thread can record per frame, the rest are dropped and counted
+    static constexpr std::size_t CAPACITY = 1 << 16;
+
+private:
+    std::unique_ptr<ProfileEvent[]> mEvents = std::make_unique<ProfileEvent[]>(CAPACITY);
+    std::atomic<std::size_t> mCount{0};
+    std::atomic<std::size_t> mDropped{0};
+
+public:
+    const std::uint32_t mThread;
+
+    explicit ProfileBuffer(std::uint32_t thread) : mThread(thread)
+    {
+    }
+
+    void Push(const ProfileEvent &event)
+    {
+        std::size_t count = mCount.load(std::memory_order_relaxed);
+        if (count == CAPACITY)
+        {
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        mEvents[count] = event;
+        mCount.store(count + 1, std::memory_order_release);
+    }
+
+    std::size_t Size() const
+    {
+        return mCount.load(std::memory_order_acquire);
+    }
+
+    const ProfileEvent &operator[](std::size_t index) const
+    {
+        return mEvents[index];
+    }
+
+    // Empties the buffer, returns the events dropped since the last call
+    std::size_t Clear()
+    {
+        mCount.store(0, std::memory_order_relaxed);
+        return mDropped.exchange(0, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @brief Collects the scopes and counters that threads record during a frame.
+ *
+ * EndFrame gathers every thread's buffer once per frame, it sums each scope for the frame,
+ * appends the events to the Chrome trace and the per-frame rows to the CSV when those are
+ * open, and keeps a short history of frame times for an overlay. Use the PROFILE_SCOPE and
+ * PROFILE_COUNTER macros, they compile to nothing unless TRIQUI_PROFILE is defined.
+ */
+class PROFILER_EXPORT Profiler
+{
+public:
+    static constexpr std::size_t FRAME_HISTORY = 240;
+    // Frame time histogram buckets, each FRAME_BUCKET_MILLISECONDS wide, the last one also
+    // counts every slower frame
+    static constexpr std::size_t FRAME_BUCKETS = 20;
+    static constexpr float FRAME_BUCKET_MILLISECONDS = 2.0f;
+
+    /**
+     * @brief Calls and total time of one scope name over the last frame.
+     */
+    struct ScopeTotal
+    {
+        const char *name;
+        std::uint64_t calls = 0;
+        std::uint64_t nanoseconds = 0;
+    };
+
+    struct CounterValue
+    {
+        const char *name;
+        std::int64_t value = 0;
+    };
+
+private:
+    std::chrono::steady_clock::time_point mEpoch = std::chrono::steady_clock::now();
+
+    std::mutex mBuffersMutex;
+    std::vector<std::unique_ptr<ProfileBuffer>> mBuffers{};
+    static inline thread_local ProfileBuffer *tBuffer = nullptr;
+
+    std::uint64_t mFrame = 0;
+    std::uint64_t mFrameStart = 0;
+    std::array<float, FRAME_HISTORY> mFrameTimes{};
+    std::size_t mFrameTimeCount = 0;
+    std::vector<ScopeTotal> mScopes{};
+    std::vector<CounterValue> mCounters{};
+    std::uint64_t mDropped = 0;
+
+    std::FILE *mTrace = nullptr;
+    bool mTraceEmpty = true;
+    std::FILE *mCsv = nullptr;
+
+    ProfileBuffer &ThreadBuffer()
+    {
+        if (tBuffer == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(mBuffersMutex);
+            mBuffers.push_back(std::make_unique<ProfileBuffer>(std::uint32_t(mBuffers.size())));
+            tBuffer = mBuffers.back().get();
+        }
+
+        return *tBuffer;
+    }
+
+    template <typename T>
+    static T &Find(std::vector<T> &entries, const char *name)
+    {
+        for (auto &entry : entries)
+        {
+            if (entry.name == name || std::strcmp(entry.name, name) == 0)
+            {
+                return entry;
+            }
+        }
+
+        entries.push_back(T{name});
+        return entries.back();
+    }
+
+    void TraceSeparator()
+    {
+        std::fputs(mTraceEmpty ? "\n" : ",\n", mTrace);
+        mTraceEmpty = false;
+    }
+
+    void TraceEvent(const ProfileEvent &event, std::uint32_t thread)
+    {
+        TraceSeparator();
+        if (event.counter)
+        {
+            std::fprintf(mTrace, "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":0,\"tid\":%u,\"args\":{\"value\":%lld}}", event.name,
+                         event.start / 1000.0, thread, static_cast<long long>(event.value));
+        }
+        else
+        {
+            std::fprintf(mTrace, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}", event.name,
+                         event.start / 1000.0, event.duration / 1000.0, thread);
+        }
+    }
+
+public:
+    static Profiler &Instance()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    ~Profiler()
+    {
+        CloseTrace();
+        CloseCsv();
+    }
+
+    std::uint64_t Now() const
+    {
+        return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - mEpoch).count());
+    }
+
+    void RecordScope(const char *name, std::uint64_t start, std::uint64_t end)
+    {
+        ThreadBuffer().Push(ProfileEvent{name, start, end - start, 0, false});
+    }
+
+    void RecordCounter(const char *name, std::int64_t value)
+    {
+        ThreadBuffer().Push(ProfileEvent{name, Now(), 0, value, true});
+    }
+
+    /**
+     * @brief Starts writing every event to a Chrome trace file (chrome://tracing, Perfetto).
+     */
+    bool OpenTrace(const char *path)
+    {
+        CloseTrace();
+        mTrace = std::fopen(path, "w");
+        mTraceEmpty = true;
+        if (mTrace != nullptr)
+        {
+            std::fputs("[", mTrace);
+        }
+        return mTrace != nullptr;
+    }
+
+    void CloseTrace()
+    {
+        if (mTrace == nullptr)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mBuffersMutex);
+        for (const auto &buffer : mBuffers)
+        {
+            TraceSeparator();
+            std::fprintf(mTrace, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}", buffer->mThread,
+                         buffer->mThread);
+        }
+        std::fputs("\n]\n", mTrace);
+        std::fclose(mTrace);
+        mTrace = nullptr;
+    }
+
+    /**
+     * @brief Starts writing one row per frame and scope: frame,name,calls,total_us.
+     *
+     * The row named "frame" is the time from the previous EndFrame.
+     */
+    bool OpenCsv(const char *path)
+    {
+        CloseCsv();
+        mCsv = std::fopen(path, "w");
+        if (mCsv != nullptr)
+        {
+            std::fputs("frame,name,calls,total_us\n", mCsv);
+        }
+        return mCsv != nullptr;
+    }
+
+    void CloseCsv()
+    {
+        if (mCsv != nullptr)
+        {
+            std::fclose(mCsv);
+            mCsv = nullptr;
+        }
+    }
+
+    /**
+     * @brief Closes the frame, call it on the main thread at a point where no thread records.
+     */
+    void EndFrame()
+    {
+        std::uint64_t now = Now();
+        std::uint64_t frameTime = now - mFrameStart;
+
+        for (auto &scope : mScopes)
+        {
+            scope.calls = 0;
+            scope.nanoseconds = 0;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mBuffersMutex);
+            for (const auto &buffer : mBuffers)
+            {
+                std::size_t size = buffer->Size();
+                for (std::size_t i = 0; i < size; ++i)
+                {
+                    const ProfileEvent &event = (*buffer)[i];
+                    if (event.counter)
+                    {
+                        Find(mCounters, event.name).value = event.value;
+                    }
+                    else
+                    {
+                        auto &scope = Find(mScopes, event.name);
+                        scope.calls++;
+                        scope.nanoseconds += event.duration;
+                    }
+
+                    if (mTrace != nullptr)
+                    {
+                        TraceEvent(event, buffer->mThread);
+                    }
+                }
+                mDropped += buffer->Clear();
+            }
+        }
+
+        if (mCsv != nullptr)
+        {
+            unsigned long long frame = mFrame;
+            std::fprintf(mCsv, "%llu,frame,1,%.3f\n", frame, frameTime / 1000.0);
+            for (const auto &scope : mScopes)
+            {
+                if (scope.calls > 0)
+                {
+                    std::fprintf(mCsv, "%llu,%s,%llu,%.3f\n", frame, scope.name, static_cast<unsigned long long>(scope.calls),
+                                 scope.nanoseconds / 1000.0);
+                }
+            }
+        }
+
+        mFrameTimes[mFrame % FRAME_HISTORY] = float(frameTime / 1e6);
+        mFrameTimeCount = std::min(mFrameTimeCount + 1, FRAME_HISTORY);
+        mFrame++;
+        mFrameStart = now;
+    }
+
+    std::uint64_t Frame() const
+    {
+        return mFrame;
+    }
+
+    /**
+     * @brief Milliseconds of the last `FrameTimeCount()` frames, `age` 0 is the newest.
+     */
+    float FrameTime(std::size_t age) const
+    {
+        return mFrameTimes[(mFrame - 1 - age) % FRAME_HISTORY];
+    }
+
+    std::size_t FrameTimeCount() const
+    {
+        return mFrameTimeCount;
+    }
+
+    /**
+     * @brief Buckets the frame times of the history, see FRAME_BUCKETS.
+     */
+    std::array<std::uint32_t, FRAME_BUCKETS> FrameTimeHistogram() const
+    {
+        std::array<std::uint32_t, FRAME_BUCKETS> counts{};
+        for (std::size_t age = 0; age < mFrameTimeCount; age++)
+        {
+            auto bucket = std::size_t(std::max(FrameTime(age), 0.0f) / FRAME_BUCKET_MILLISECONDS);
+            counts[std::min(bucket, FRAME_BUCKETS - 1)]++;
+        }
+
+        return counts;
+    }
+
+    const std::vector<ScopeTotal> &Scopes() const
+    {
+        return mScopes;
+    }
+
+    // Last value recorded for each counter
+    const std::vector<CounterValue> &Counters() const
+    {
+        return mCounters;
+    }
+
+    // Events lost to full buffers so far
+    std::uint64_t Dropped() const
+    {
+        return mDropped;
+    }
+};
+
+/**
+ * @brief Records the time from its construction to the end of the scope.
+ */
+class PROFILER_EXPORT ProfileScope
+{
+private:
+    const char *mName;
+    std::uint64_t mStart;
+
+public:
+    explicit ProfileScope(const char *name) : mName(name), mStart(Profiler::Instance().Now())
+    {
+    }
+
+    ~ProfileScope()
+    {
+        Profiler &profiler = Profiler::Instance();
+        profiler.RecordScope(mName, mStart, profiler.Now());
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+};
+
+#ifdef TRIQUI_PROFILE
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Times the rest of the enclosing scope under a string literal name
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_COUNTER(name, value) Profiler::Instance().RecordCounter(name, std::int64_t(value))
+// Ends the frame, see Profiler::EndFrame
+#define PROFILE_FRAME() Profiler::Instance().EndFrame()
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_COUNTER(name, value) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#endif
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "entity-component-system.h"
+#include "thread-pool.h"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Runs a frame's systems, in parallel where their declared component accesses allow.
+ *
+ * Every frame the scheduler builds a dependency graph from System::mReads and System::mWrites:
+ * a system depends on every system added before it that writes a component it reads or writes,
+ * or reads a component it writes. Systems without pending dependencies run on the ThreadPool,
+ * except the ones with System::mMainThreadOnly, which run on the thread that called Run.
+ */
+class ECS_EXPORT Scheduler
+{
+private:
+    struct Entry
+    {
+        std::shared_ptr<System> system;
+        std::function<void()> update;
+        // Profiler scope of the update, a string literal
+        const char *name;
+    };
+
+    std::vector<Entry> mEntries{};
+
+    // Per-frame graph state
+    std::vector<std::vector<std::size_t>> mDependents{};
+    std::unique_ptr<std::atomic<std::size_t>[]> mRemaining{};
+    std::vector<std::size_t> mRoots{};
+    std::atomic<std::size_t> mCompleted{0};
+    std::vector<std::size_t> mMainThreadReady{};
+    std::mutex mMainThreadMutex;
+    std::condition_variable mMainThreadWake;
+    TaskGroup mGroup;
+
+    static bool Conflicts(const System &a, const System &b)
+    {
+        return (a.mWrites & (b.mReads | b.mWrites)).any() || (b.mWrites & a.mReads).any();
+    }
+
+    void BuildGraph()
+    {
+        std::size_t count = mEntries.size();
+        mDependents.assign(count, {});
+        mRemaining = std::make_unique<std::atomic<std::size_t>[]>(count);
+        mRoots.clear();
+
+        for (std::size_t later = 0; later < count; ++later)
+        {
+            std::size_t dependencies = 0;
+            for (std::size_t earlier = 0; earlier < later; ++earlier)
+            {
+                if (Conflicts(*mEntries[earlier].system, *mEntries[later].system))
+                {
+                    mDependents[earlier].push_back(later);
+                    ++dependencies;
+                }
+            }
+            mRemaining[later] = dependencies;
+            if (dependencies == 0)
+            {
+                mRoots.push_back(later);
+            }
+        }
+    }
+
+    void Dispatch(std::size_t index, ThreadPool &pool)
+    {
+        if (mEntries[index].system->mMainThreadOnly)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMainThreadMutex);
+                mMainThreadReady.push_back(index);
+            }
+            mMainThreadWake.notify_one();
+        }
+        else
+        {
+            pool.Submit([this, index, &pool]
+                        { RunEntry(index, pool); },
+                        &mGroup);
+        }
+    }
+
+    void RunEntry(std::size_t index, ThreadPool &pool)
+    {
+        {
+            PROFILE_SCOPE(mEntries[index].name);
+            mEntries[index].update();
+        }
+
+        for (std::size_t dependent : mDependents[index])
+        {
+            if (--mRemaining[dependent] == 0)
+            {
+                Dispatch(dependent, pool);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMainThreadMutex);
+            ++mCompleted;
+        }
+        mMainThreadWake.notify_one();
+    }
+
+public:
+    /**
+     * @brief Adds a system to the frame, systems run in the order they were added unless independent.
+     *
+     * @param system The system, its declared accesses decide what it can run alongside.
+     * @param update Runs the system for one frame, e.g. [&] { renderSystem->Update(game); }
+     * @param name Names the update in profiles, a string literal.
+     */
+    void Add(std::shared_ptr<System> system, std::function<void()> update, const char *name = "System::Update")
+    {
+        mEntries.push_back(Entry{std::move(system), std::move(update), name});
+    }
+
+    /**
+     * @brief Runs every system once and returns when all of them have finished.
+     */
+    void Run(ThreadPool &pool)
+    {
+        PROFILE_SCOPE("Scheduler::Run");
+        BuildGraph();
+        mCompleted = 0;
+        mMainThreadReady.clear();
+
+        // Roots come from the graph, a dependent whose count a finished root already brought to 0
+        // must not be dispatched a second time here
+        for (std::size_t index : mRoots)
+        {
+            Dispatch(index, pool);
+        }
+
+        while (mCompleted < mEntries.size())
+        {
+            std::size_t next = mEntries.size();
+            {
+                std::lock_guard<std::mutex> lock(mMainThreadMutex);
+                if (!mMainThreadReady.empty())
+                {
+                    next = mMainThreadReady.back();
+                    mMainThreadReady.pop_back();
+                }
+            }
+
+            if (next < mEntries.size())
+            {
+                RunEntry(next, pool);
+            }
+            else if (!pool.RunPendingTask())
+            {
+                std::unique_lock<std::mutex> lock(mMainThreadMutex);
+                mMainThreadWake.wait(lock, [this]
+                                     { return !mMainThreadReady.empty() || mCompleted == mEntries.size(); });
+            }
+        }
+
+        // Worker tasks decrement the group after RunEntry returns, wait for them to let go of it
+        pool.Wait(mGroup);
+    }
+};
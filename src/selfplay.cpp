@@ -0,0 +1,274 @@
+#include "game.h"
+#include "latency-histogram.h"
+#include "mcts.h"
+#include "perfect-play.h"
+#include "thread-pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Plays games between two engines on every core, without the ECS or a window, and reports
+// throughput, results and move latencies. Engine A plays 'X' unless --alternate swaps the
+// colors every game.
+//
+// Usage: triqui_selfplay [--games N] [--a ENGINE] [--b ENGINE] [--alternate] [--seed S]
+//                        [--threads T] [--board width,height,winLength]
+//
+// ENGINE is random, perfect (3,3,3 only) or mcts:PLAYOUTS, for example mcts:2000.
+
+namespace
+{
+    struct EngineSpec
+    {
+        std::string name;
+        std::uint64_t playouts = 0;
+    };
+
+    bool ParseEngine(const char *text, EngineSpec &spec)
+    {
+        if (std::strcmp(text, "random") == 0 || std::strcmp(text, "perfect") == 0)
+        {
+            spec = EngineSpec{text, 0};
+            return true;
+        }
+
+        if (std::strncmp(text, "mcts:", 5) == 0)
+        {
+            spec = EngineSpec{text, std::strtoull(text + 5, nullptr, 10)};
+            return spec.playouts > 0;
+        }
+
+        return false;
+    }
+
+    std::unique_ptr<EngineMoveSource> MakeEngine(const EngineSpec &spec, ThreadPool &pool, std::uint32_t seed)
+    {
+        if (spec.name == "random")
+        {
+            return std::make_unique<RandomMoveSource>(seed);
+        }
+        if (spec.name == "perfect")
+        {
+            return std::make_unique<PerfectMoveSource>();
+        }
+
+        // Games already run on every core, so each search stays on its own thread
+        MctsConfig config;
+        config.limits = MctsLimits{0.0, spec.playouts};
+        config.threads = 1;
+        config.nodeCapacity = 1u << 18;
+        config.seed = seed;
+        return std::make_unique<MctsMoveSource>(pool, config);
+    }
+
+    enum Outcome
+    {
+        WIN,
+        DRAW,
+        LOSS
+    };
+
+    // Everything a worker counts, merged once at the end
+    struct WorkerResults
+    {
+        // [engine A, engine B][WIN, DRAW, LOSS]
+        std::uint64_t results[2][3] = {};
+        // X wins, draws, O wins
+        std::uint64_t byColor[3] = {};
+        LatencyHistogram latency[2];
+    };
+}
+
+int main(int argc, char **argv)
+{
+    long games = 100000;
+    EngineSpec specs[2] = {{"random", 0}, {"random", 0}};
+    bool alternate = false;
+    std::uint32_t seed = 1;
+    long threads = 0;
+    BoardRules rules = CLASSIC_RULES;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--games") == 0 && i + 1 < argc)
+        {
+            games = std::atol(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--a") == 0 && i + 1 < argc && ParseEngine(argv[i + 1], specs[0]))
+        {
+            i++;
+        }
+        else if (std::strcmp(argv[i], "--b") == 0 && i + 1 < argc && ParseEngine(argv[i + 1], specs[1]))
+        {
+            i++;
+        }
+        else if (std::strcmp(argv[i], "--alternate") == 0)
+        {
+            alternate = true;
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = std::atol(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--board") == 0 && i + 1 < argc && ParseBoardRules(argv[i + 1], rules))
+        {
+            i++;
+        }
+        else
+        {
+            std::fprintf(stderr,
+                         "usage: %s [--games N] [--a ENGINE] [--b ENGINE] [--alternate] [--seed S] [--threads T] [--board width,height,winLength]\n"
+                         "ENGINE is random, perfect or mcts:PLAYOUTS\n",
+                         argv[0]);
+            return 1;
+        }
+    }
+
+    if (games <= 0)
+    {
+        std::fprintf(stderr, "--games needs at least 1 game\n");
+        return 1;
+    }
+
+    bool classic = rules.width == 3 && rules.height == 3 && rules.winLength == 3;
+    for (const auto &spec : specs)
+    {
+        if (spec.name == "perfect" && !classic)
+        {
+            std::fprintf(stderr, "perfect only plays the 3,3,3 board\n");
+            return 1;
+        }
+    }
+
+    ThreadPool pool(threads > 0 ? std::size_t(threads - 1) : std::max(1u, std::thread::hardware_concurrency()) - 1);
+    // The pool always has a worker, --threads 1 still plays every game on this thread
+    std::size_t workers = threads > 0 ? std::size_t(threads) : pool.ThreadCount() + 1;
+    std::vector<WorkerResults> results(workers);
+    std::atomic<long> nextGame{0};
+    // Set when an engine finds no move in a game that is not over, every worker stops then
+    std::atomic<bool> enginePassed{false};
+
+    auto start = std::chrono::steady_clock::now();
+    TaskGroup group;
+    auto work = [&](std::size_t worker)
+    {
+        std::unique_ptr<EngineMoveSource> engines[2] = {
+            MakeEngine(specs[0], pool, seed + std::uint32_t(worker) * 2),
+            MakeEngine(specs[1], pool, seed + std::uint32_t(worker) * 2 + 1)};
+        WorkerResults &local = results[worker];
+
+        // One GameStatus per worker, reset in place between games
+        GameStatus gameStatus;
+        for (long game = nextGame++; game < games && !enginePassed; game = nextGame++)
+        {
+            gameStatus = NewGameStatus(rules);
+            // The engine playing 'X'
+            int xEngine = alternate ? int(game % 2) : 0;
+
+            for (int toMove = 0; gameStatus.status == GameStatusEnum::PLAYING; toMove ^= 1)
+            {
+                int engine = toMove == 0 ? xEngine : 1 - xEngine;
+
+                auto before = std::chrono::steady_clock::now();
+                int cell = engines[engine]->ChooseCell(gameStatus, toMove);
+                auto after = std::chrono::steady_clock::now();
+                if (cell < 0)
+                {
+                    enginePassed = true;
+                    return;
+                }
+                local.latency[engine].Add(std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count()));
+
+                ApplyMove(gameStatus, cell, toMove);
+                EvaluateLastMove(gameStatus);
+            }
+
+            int color = gameStatus.status == GameStatusEnum::X_WIN ? 0 : gameStatus.status == GameStatusEnum::DRAW ? 1
+                                                                                                                      : 2;
+            local.byColor[color]++;
+            if (color == 1)
+            {
+                local.results[0][DRAW]++;
+                local.results[1][DRAW]++;
+            }
+            else
+            {
+                int winner = color == 0 ? xEngine : 1 - xEngine;
+                local.results[winner][WIN]++;
+                local.results[1 - winner][LOSS]++;
+            }
+        }
+    };
+
+    for (std::size_t worker = 1; worker < workers; worker++)
+    {
+        pool.Submit([&work, worker]
+                    { work(worker); },
+                    &group);
+    }
+    work(0);
+    pool.Wait(group);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (enginePassed)
+    {
+        std::fprintf(stderr, "an engine found no move in a game that was not over\n");
+        return 1;
+    }
+
+    WorkerResults total;
+    for (const auto &local : results)
+    {
+        for (int engine = 0; engine < 2; engine++)
+        {
+            for (int outcome = 0; outcome < 3; outcome++)
+            {
+                total.results[engine][outcome] += local.results[engine][outcome];
+            }
+            total.latency[engine].Merge(local.latency[engine]);
+        }
+        for (int color = 0; color < 3; color++)
+        {
+            total.byColor[color] += local.byColor[color];
+        }
+    }
+    std::uint64_t moves = total.latency[0].total + total.latency[1].total;
+
+    std::printf("board %d,%d,%d, %ld games on %zu threads%s\n", rules.width, rules.height, rules.winLength, games, workers,
+                alternate ? ", alternating colors" : "");
+    std::printf("%.3f s, %.0f games/s, %.0f moves/s\n\n", seconds, games / seconds, moves / seconds);
+
+    std::printf("%-18s %10s %10s %10s %7s %7s %7s\n", "engine", "wins", "draws", "losses", "win%", "draw%", "loss%");
+    for (int engine = 0; engine < 2; engine++)
+    {
+        const auto &r = total.results[engine];
+        double played = double(r[WIN] + r[DRAW] + r[LOSS]);
+        std::printf("%c %-16s %10llu %10llu %10llu %6.1f%% %6.1f%% %6.1f%%\n", 'A' + engine, specs[engine].name.c_str(),
+                    static_cast<unsigned long long>(r[WIN]), static_cast<unsigned long long>(r[DRAW]), static_cast<unsigned long long>(r[LOSS]),
+                    100.0 * r[WIN] / played, 100.0 * r[DRAW] / played, 100.0 * r[LOSS] / played);
+    }
+    std::printf("\nX wins %llu, draws %llu, O wins %llu\n\n", static_cast<unsigned long long>(total.byColor[0]),
+                static_cast<unsigned long long>(total.byColor[1]), static_cast<unsigned long long>(total.byColor[2]));
+
+    std::printf("%-18s %12s %10s %10s %10s %10s %10s\n", "move latency (us)", "moves", "mean", "p50", "p90", "p99", "max");
+    for (int engine = 0; engine < 2; engine++)
+    {
+        const auto &latency = total.latency[engine];
+        std::printf("%c %-16s %12llu %10.2f %10.2f %10.2f %10.2f %10.2f\n", 'A' + engine, specs[engine].name.c_str(),
+                    static_cast<unsigned long long>(latency.total), latency.total ? latency.sumNs / 1000.0 / latency.total : 0.0,
+                    latency.Percentile(0.50) / 1000.0, latency.Percentile(0.90) / 1000.0, latency.Percentile(0.99) / 1000.0, latency.maxNs / 1000.0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,575 @@
+#include "game.h"
+#include "match-protocol.h"
+#include "thread-pool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <sys/epoll.h>
+
+// Hosts matches between clients over TCP and a Unix socket, with the same rules and GameSystem
+// as the windowed game, see match-protocol.h for the messages. Each match is a game entity.
+//
+// One thread runs an epoll loop. The moves that arrive in one wakeup are checked and applied
+// as they are decoded, then a single GameSystem update evaluates every game they touched on
+// the thread pool, and the replies of the whole batch are sent at the end of it.
+//
+// Usage: triqui_server [--host ADDRESS] [--port P] [--unix PATH] [--board width,height,winLength]
+
+namespace
+{
+    // Ready sockets taken per epoll_wait, the moves they carry make one batch
+    constexpr int MAX_EVENTS = 1024;
+    constexpr std::uint32_t NO_CONNECTION = ~0u;
+    // epoll tags of the listening sockets, connections are tagged with their slot
+    constexpr std::uint64_t TCP_LISTENER = ~std::uint64_t(0);
+    constexpr std::uint64_t UNIX_LISTENER = ~std::uint64_t(0) - 1;
+
+    volatile std::sig_atomic_t gStop = 0;
+
+    void Stop(int)
+    {
+        gStop = 1;
+    }
+
+    struct Connection
+    {
+        int socket = -1;
+        MatchBuffers buffers;
+        // Registered for EPOLLOUT, while the socket did not take all its output
+        bool waitingWritable = false;
+        // In the list of connections to flush at the end of the batch
+        bool dirty = false;
+        // Its output is full, it is closed at the end of the batch
+        bool closing = false;
+        bool waiting = false;
+        bool playing = false;
+        // The game of its match and its player in it, while playing
+        Entity game = 0;
+        int player = 0;
+    };
+
+    struct Match
+    {
+        std::uint32_t players[2] = {NO_CONNECTION, NO_CONNECTION};
+        // A move waits for GameSystem in this batch, further ones are rejected until then
+        bool moved = false;
+    };
+
+    class MatchServer
+    {
+    private:
+        BoardRules mRules;
+        ThreadPool &mThreadPool;
+        std::shared_ptr<GameSystem> mGameSystem;
+
+        int mEpoll = -1;
+        int mTcpListener = -1;
+        int mUnixListener = -1;
+        const char *mUnixPath = nullptr;
+
+        // Connection slots are reused, so their buffers are allocated once per slot
+        std::vector<std::unique_ptr<Connection>> mConnections{};
+        std::vector<std::uint32_t> mFreeSlots{};
+        // Slots closed in this batch, freed once no event of the batch can refer to them
+        std::vector<std::uint32_t> mClosedSlots{};
+        std::vector<std::uint32_t> mDirty{};
+        std::deque<std::uint32_t> mLobby{};
+        // Indexed by game entity
+        std::vector<Match> mMatches{};
+        std::vector<Entity> mMoved{};
+
+        std::size_t mConnectionCount = 0;
+        std::size_t mMatchCount = 0;
+        std::uint64_t mMoves = 0;
+        std::uint64_t mGames = 0;
+        std::uint64_t mBatches = 0;
+
+        bool Listen(int listener, const sockaddr *address, socklen_t length, std::uint64_t tag)
+        {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u64 = tag;
+            return ::bind(listener, address, length) == 0 && ::listen(listener, SOMAXCONN) == 0 &&
+                   ::epoll_ctl(mEpoll, EPOLL_CTL_ADD, listener, &event) == 0;
+        }
+
+        void Accept(int listener, bool tcp)
+        {
+            for (;;)
+            {
+                int socket = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (socket < 0)
+                {
+                    // EAGAIN once the backlog is empty, EMFILE leaves the rest in it for now
+                    return;
+                }
+
+                if (tcp)
+                {
+                    int noDelay = 1;
+                    ::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+                }
+
+                std::uint32_t slot;
+                if (mFreeSlots.empty())
+                {
+                    slot = std::uint32_t(mConnections.size());
+                    mConnections.push_back(std::make_unique<Connection>());
+                }
+                else
+                {
+                    slot = mFreeSlots.back();
+                    mFreeSlots.pop_back();
+                }
+
+                Connection &connection = *mConnections[slot];
+                connection.socket = socket;
+                connection.buffers.Clear();
+                connection.waitingWritable = false;
+                connection.dirty = false;
+                connection.closing = false;
+                connection.waiting = false;
+                connection.playing = false;
+
+                epoll_event event{};
+                event.events = EPOLLIN;
+                event.data.u64 = slot;
+                ::epoll_ctl(mEpoll, EPOLL_CTL_ADD, socket, &event);
+                mConnectionCount++;
+            }
+        }
+
+        void Send(std::uint32_t slot, const MatchMessage &message)
+        {
+            Connection &connection = *mConnections[slot];
+            if (!connection.buffers.Push(message))
+            {
+                connection.closing = true;
+            }
+
+            if (!connection.dirty)
+            {
+                connection.dirty = true;
+                mDirty.push_back(slot);
+            }
+        }
+
+        void StartMatch(std::uint32_t x, std::uint32_t o)
+        {
+            Entity game = CreateGame(mRules);
+            if (game >= mMatches.size())
+            {
+                mMatches.resize(std::size_t(game) + 1);
+            }
+            mMatches[game] = Match{{x, o}, false};
+            mMatchCount++;
+
+            std::uint32_t players[2] = {x, o};
+            for (int player = 0; player < 2; player++)
+            {
+                Connection &connection = *mConnections[players[player]];
+                connection.waiting = false;
+                connection.playing = true;
+                connection.game = game;
+                connection.player = player;
+                Send(players[player], MatchMessage{MatchMessageType::START, player == 0 ? 'X' : 'O', std::uint8_t(mRules.width),
+                                                   std::uint8_t(mRules.height), std::uint32_t(mRules.winLength)});
+            }
+        }
+
+        void EndMatch(Entity game)
+        {
+            for (std::uint32_t slot : mMatches[game].players)
+            {
+                mConnections[slot]->playing = false;
+            }
+
+            mMatches[game] = Match{};
+            gCoordinator.DestroyEntity(game);
+            mMatchCount--;
+        }
+
+        void Move(std::uint32_t slot, const MatchMessage &message)
+        {
+            Connection &connection = *mConnections[slot];
+            if (!connection.playing || mMatches[connection.game].moved)
+            {
+                Send(slot, MatchMessage{MatchMessageType::REJECTED, '-', message.row, message.col, message.sequence});
+                return;
+            }
+
+            Entity game = connection.game;
+            const auto &gameStatus = gCoordinator.ReadComponent<GameStatus>(game);
+            const auto &playerTurn = gCoordinator.ReadComponent<PlayerTurn>(game);
+            int cell = CellIndex(mRules, BoardPosition{message.row, message.col});
+            if (gameStatus.status != GameStatusEnum::PLAYING || PlayerIndex(playerTurn.symbol) != connection.player ||
+                message.row >= mRules.height || message.col >= mRules.width || TestCell(gameStatus.marks[0], cell) ||
+                TestCell(gameStatus.marks[1], cell))
+            {
+                Send(slot, MatchMessage{MatchMessageType::REJECTED, '-', message.row, message.col, message.sequence});
+                return;
+            }
+
+            // Written through GetComponent, so GameSystem sees the game changed
+            ApplyMove(gCoordinator.GetComponent<GameStatus>(game), cell, connection.player);
+            gCoordinator.GetComponent<PlayerTurn>(game).symbol = connection.player == 0 ? 'O' : 'X';
+
+            Match &match = mMatches[game];
+            match.moved = true;
+            mMoved.push_back(game);
+            mMoves++;
+
+            for (std::uint32_t player : match.players)
+            {
+                Send(player, MatchMessage{MatchMessageType::MOVED, connection.player == 0 ? 'X' : 'O', message.row, message.col,
+                                          message.sequence});
+            }
+        }
+
+        bool Handle(std::uint32_t slot, const MatchMessage &message)
+        {
+            Connection &connection = *mConnections[slot];
+            switch (message.type)
+            {
+            case MatchMessageType::JOIN:
+                if (!connection.waiting && !connection.playing)
+                {
+                    connection.waiting = true;
+                    mLobby.push_back(slot);
+                }
+                return true;
+            case MatchMessageType::MOVE:
+                Move(slot, message);
+                return true;
+            default:
+                // Only the server sends the other messages
+                return false;
+            }
+        }
+
+        void Close(std::uint32_t slot)
+        {
+            Connection &connection = *mConnections[slot];
+            if (connection.socket < 0)
+            {
+                return;
+            }
+
+            if (connection.waiting)
+            {
+                mLobby.erase(std::find(mLobby.begin(), mLobby.end(), slot));
+                connection.waiting = false;
+            }
+
+            if (connection.playing)
+            {
+                // The opponent wins by forfeit
+                std::uint32_t opponent = mMatches[connection.game].players[1 - connection.player];
+                Send(opponent, MatchMessage{MatchMessageType::OVER, connection.player == 0 ? 'O' : 'X', 1, 0, 0});
+                EndMatch(connection.game);
+                mGames++;
+            }
+
+            ::epoll_ctl(mEpoll, EPOLL_CTL_DEL, connection.socket, nullptr);
+            ::close(connection.socket);
+            connection.socket = -1;
+            mClosedSlots.push_back(slot);
+            mConnectionCount--;
+        }
+
+        void Receive(std::uint32_t slot)
+        {
+            Connection &connection = *mConnections[slot];
+            if (!connection.buffers.Receive(connection.socket, [this, slot](const MatchMessage &message)
+                                            { return Handle(slot, message); }))
+            {
+                Close(slot);
+            }
+        }
+
+        void Flush()
+        {
+            // Closing a connection can queue a message for its opponent, so the list may grow
+            for (std::size_t i = 0; i < mDirty.size(); i++)
+            {
+                Connection &connection = *mConnections[mDirty[i]];
+                connection.dirty = false;
+                if (connection.socket < 0)
+                {
+                    continue;
+                }
+                if (connection.closing || !connection.buffers.Flush(connection.socket))
+                {
+                    Close(mDirty[i]);
+                    continue;
+                }
+
+                bool pending = connection.buffers.Pending();
+                if (pending != connection.waitingWritable)
+                {
+                    epoll_event event{};
+                    event.events = pending ? EPOLLIN | EPOLLOUT : EPOLLIN;
+                    event.data.u64 = mDirty[i];
+                    ::epoll_ctl(mEpoll, EPOLL_CTL_MOD, connection.socket, &event);
+                    connection.waitingWritable = pending;
+                }
+            }
+            mDirty.clear();
+        }
+
+        /**
+         * @brief Evaluates the moves of the batch, ends the games they finished, pairs the
+         * waiting clients and sends every reply.
+         */
+        void EndBatch()
+        {
+            mGameSystem->Update(mThreadPool);
+
+            for (Entity game : mMoved)
+            {
+                // A forfeit may have ended the match earlier in the batch
+                if (!mMatches[game].moved)
+                {
+                    continue;
+                }
+                mMatches[game].moved = false;
+
+                const auto &gameStatus = gCoordinator.ReadComponent<GameStatus>(game);
+                if (gameStatus.status == GameStatusEnum::PLAYING)
+                {
+                    continue;
+                }
+
+                char winner = gameStatus.status == GameStatusEnum::X_WIN ? 'X' : gameStatus.status == GameStatusEnum::O_WIN ? 'O'
+                                                                                                                             : '-';
+                for (std::uint32_t player : mMatches[game].players)
+                {
+                    Send(player, MatchMessage{MatchMessageType::OVER, winner, 0, 0, 0});
+                }
+                EndMatch(game);
+                mGames++;
+            }
+            mMoved.clear();
+
+            while (mLobby.size() >= 2)
+            {
+                std::uint32_t x = mLobby.front();
+                mLobby.pop_front();
+                std::uint32_t o = mLobby.front();
+                mLobby.pop_front();
+                StartMatch(x, o);
+            }
+
+            Flush();
+
+            mFreeSlots.insert(mFreeSlots.end(), mClosedSlots.begin(), mClosedSlots.end());
+            mClosedSlots.clear();
+            mBatches++;
+        }
+
+    public:
+        MatchServer(const BoardRules &rules, ThreadPool &threadPool, std::shared_ptr<GameSystem> gameSystem)
+            : mRules(rules), mThreadPool(threadPool), mGameSystem(std::move(gameSystem))
+        {
+            mEpoll = ::epoll_create1(EPOLL_CLOEXEC);
+        }
+
+        ~MatchServer()
+        {
+            for (const auto &connection : mConnections)
+            {
+                if (connection->socket >= 0)
+                {
+                    ::close(connection->socket);
+                }
+            }
+            if (mTcpListener >= 0)
+            {
+                ::close(mTcpListener);
+            }
+            if (mUnixListener >= 0)
+            {
+                ::close(mUnixListener);
+                ::unlink(mUnixPath);
+            }
+            ::close(mEpoll);
+        }
+
+        MatchServer(const MatchServer &) = delete;
+        MatchServer &operator=(const MatchServer &) = delete;
+
+        bool ListenTcp(const char *host, std::uint16_t port)
+        {
+            sockaddr_in address;
+            if (!FillTcpAddress(host, port, address))
+            {
+                return false;
+            }
+
+            mTcpListener = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            int reuse = 1;
+            ::setsockopt(mTcpListener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+            return mTcpListener >= 0 && Listen(mTcpListener, reinterpret_cast<const sockaddr *>(&address), sizeof(address), TCP_LISTENER);
+        }
+
+        bool ListenUnix(const char *path)
+        {
+            sockaddr_un address;
+            if (!FillUnixAddress(path, address))
+            {
+                return false;
+            }
+
+            // A socket file left by a previous run would make bind fail
+            ::unlink(path);
+            mUnixPath = path;
+            mUnixListener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            return mUnixListener >= 0 && Listen(mUnixListener, reinterpret_cast<const sockaddr *>(&address), sizeof(address), UNIX_LISTENER);
+        }
+
+        void Run()
+        {
+            epoll_event events[MAX_EVENTS];
+            auto start = std::chrono::steady_clock::now();
+            auto lastReport = start;
+            std::uint64_t reportedMoves = 0;
+
+            while (!gStop)
+            {
+                int count = ::epoll_wait(mEpoll, events, MAX_EVENTS, 1000);
+                if (count < 0 && errno != EINTR)
+                {
+                    std::perror("epoll_wait");
+                    return;
+                }
+
+                for (int i = 0; i < count; i++)
+                {
+                    std::uint64_t tag = events[i].data.u64;
+                    if (tag == TCP_LISTENER || tag == UNIX_LISTENER)
+                    {
+                        Accept(tag == TCP_LISTENER ? mTcpListener : mUnixListener, tag == TCP_LISTENER);
+                        continue;
+                    }
+
+                    auto slot = std::uint32_t(tag);
+                    Connection &connection = *mConnections[slot];
+                    // Closed earlier in this batch
+                    if (connection.socket < 0)
+                    {
+                        continue;
+                    }
+
+                    if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    {
+                        Receive(slot);
+                    }
+                    if ((events[i].events & EPOLLOUT) && connection.socket >= 0 && !connection.dirty)
+                    {
+                        connection.dirty = true;
+                        mDirty.push_back(slot);
+                    }
+                }
+
+                EndBatch();
+
+                auto now = std::chrono::steady_clock::now();
+                double elapsed = std::chrono::duration<double>(now - lastReport).count();
+                if (elapsed >= 5.0)
+                {
+                    std::printf("%zu connections, %zu matches, %llu games, %.0f moves/s\n", mConnectionCount, mMatchCount,
+                                static_cast<unsigned long long>(mGames), (mMoves - reportedMoves) / elapsed);
+                    std::fflush(stdout);
+                    lastReport = now;
+                    reportedMoves = mMoves;
+                }
+            }
+
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::printf("%llu moves and %llu games in %.1f s, %llu batches of %.1f moves on average\n",
+                        static_cast<unsigned long long>(mMoves), static_cast<unsigned long long>(mGames), seconds,
+                        static_cast<unsigned long long>(mBatches), mBatches ? double(mMoves) / mBatches : 0.0);
+        }
+    };
+}
+
+int main(int argc, char **argv)
+{
+    const char *host = "127.0.0.1";
+    long port = DEFAULT_MATCH_PORT;
+    const char *unixPath = nullptr;
+    BoardRules rules = CLASSIC_RULES;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--host") == 0 && i + 1 < argc)
+        {
+            host = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc)
+        {
+            port = std::atol(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--unix") == 0 && i + 1 < argc)
+        {
+            unixPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--board") == 0 && i + 1 < argc && ParseBoardRules(argv[i + 1], rules))
+        {
+            i++;
+        }
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--host ADDRESS] [--port P] [--unix PATH] [--board width,height,winLength]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    RaiseFileLimit();
+    std::signal(SIGINT, Stop);
+    std::signal(SIGTERM, Stop);
+
+    ThreadPool threadPool;
+
+    gCoordinator.Init();
+    std::shared_ptr<InputSystem> inputSystem;
+    std::shared_ptr<GameSystem> gameSystem;
+    RegisterGame(inputSystem, gameSystem);
+
+    MatchServer server(rules, threadPool, gameSystem);
+    if (port > 0 && !server.ListenTcp(host, std::uint16_t(port)))
+    {
+        std::fprintf(stderr, "cannot listen on %s:%ld: %s\n", host, port, std::strerror(errno));
+        return 1;
+    }
+    if (unixPath != nullptr && !server.ListenUnix(unixPath))
+    {
+        std::fprintf(stderr, "cannot listen on %s: %s\n", unixPath, std::strerror(errno));
+        return 1;
+    }
+
+    std::printf("board %d,%d,%d, listening on", rules.width, rules.height, rules.winLength);
+    if (port > 0)
+    {
+        std::printf(" %s:%ld", host, port);
+    }
+    if (unixPath != nullptr)
+    {
+        std::printf(" %s", unixPath);
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+
+    server.Run();
+    return 0;
+}
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#define SNAPSHOT_EXPORT __declspec(dllexport)
+#else
+#define SNAPSHOT_EXPORT
+#endif
+
+/**
+ * @brief Appends blocks of raw bytes to a snapshot buffer, each block starts 8-byte aligned.
+ *
+ * The buffer is only ever appended to, so reusing one buffer for many snapshots keeps its
+ * capacity and saving stops allocating once it has grown to the size of the world.
+ */
+class SNAPSHOT_EXPORT SnapshotWriter
+{
+public:
+    static constexpr std::size_t ALIGNMENT = 8;
+
+private:
+    std::vector<std::byte> &mBuffer;
+
+public:
+    explicit SnapshotWriter(std::vector<std::byte> &buffer) : mBuffer(buffer)
+    {
+    }
+
+    /**
+     * @brief Appends a block of `size` bytes and returns it for the caller to fill.
+     *
+     * @note The pointer is only valid until the next block is appended.
+     */
+    std::byte *Allocate(std::size_t size)
+    {
+        std::size_t offset = (mBuffer.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        mBuffer.resize(offset + size);
+
+        return mBuffer.data() + offset;
+    }
+
+    void Write(const void *data, std::size_t size)
+    {
+        if (size > 0)
+        {
+            std::memcpy(Allocate(size), data, size);
+        }
+    }
+
+    template <typename T>
+    void WriteValue(const T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Snapshot values must be trivially copyable.");
+
+        Write(&value, sizeof(T));
+    }
+};
+
+/**
+ * @brief Reads back the blocks of a SnapshotWriter, in place, from memory it does not own.
+ *
+ * Reading past the end fails instead of reading out of bounds: Read returns nullptr, ReadValue
+ * a value-initialized T, and Failed() stays true from then on.
+ */
+class SNAPSHOT_EXPORT SnapshotReader
+{
+private:
+    const std::byte *mData;
+    std::size_t mSize;
+    std::size_t mOffset = 0;
+    bool mFailed = false;
+
+public:
+    SnapshotReader(const std::byte *data, std::size_t size) : mData(data), mSize(size)
+    {
+    }
+
+    /**
+     * @brief Returns the next block of `size` bytes without copying it.
+     *
+     * @return nullptr if the snapshot ends before the block does.
+     */
+    const std::byte *Read(std::size_t size)
+    {
+        std::size_t offset = (mOffset + SnapshotWriter::ALIGNMENT - 1) / SnapshotWriter::ALIGNMENT * SnapshotWriter::ALIGNMENT;
+        if (mFailed || offset > mSize || size > mSize - offset)
+        {
+            mFailed = true;
+            return nullptr;
+        }
+
+        mOffset = offset + size;
+        return mData + offset;
+    }
+
+    template <typename T>
+    T ReadValue()
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Snapshot values must be trivially copyable.");
+
+        T value{};
+        if (const std::byte *block = Read(sizeof(T)))
+        {
+            std::memcpy(&value, block, sizeof(T));
+        }
+        return value;
+    }
+
+    // Whether a read went past the end
+    bool Failed() const
+    {
+        return mFailed;
+    }
+
+    // Bytes left after the last block read, counted before the padding of the next one
+    std::size_t Remaining() const
+    {
+        return mSize - mOffset;
+    }
+};
+
+/**
+ * @brief A snapshot file mapped read-only into memory, so loading it reads the blocks in place.
+ *
+ * Falls back to reading the whole file where mmap is not available.
+ */
+class SNAPSHOT_EXPORT MappedSnapshot
+{
+private:
+    const std::byte *mData = nullptr;
+    std::size_t mSize = 0;
+#ifdef _WIN32
+    std::vector<std::byte> mContents{};
+#endif
+
+public:
+    MappedSnapshot() = default;
+
+    ~MappedSnapshot()
+    {
+        Close();
+    }
+
+    MappedSnapshot(const MappedSnapshot &) = delete;
+    MappedSnapshot &operator=(const MappedSnapshot &) = delete;
+
+    bool Open(const char *path)
+    {
+        Close();
+
+#ifdef _WIN32
+        std::FILE *file = std::fopen(path, "rb");
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        std::fseek(file, 0, SEEK_END);
+        long size = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+        mContents.resize(size > 0 ? std::size_t(size) : 0);
+        bool read = std::fread(mContents.data(), 1, mContents.size(), file) == mContents.size();
+        std::fclose(file);
+
+        if (!read)
+        {
+            mContents.clear();
+            return false;
+        }
+
+        mData = mContents.data();
+        mSize = mContents.size();
+        return true;
+#else
+        int descriptor = ::open(path, O_RDONLY);
+        if (descriptor < 0)
+        {
+            return false;
+        }
+
+        struct stat status;
+        if (::fstat(descriptor, &status) != 0 || status.st_size == 0)
+        {
+            ::close(descriptor);
+            return false;
+        }
+
+        void *mapping = ::mmap(nullptr, std::size_t(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+        // The mapping keeps the file alive on its own
+        ::close(descriptor);
+        if (mapping == MAP_FAILED)
+        {
+            return false;
+        }
+
+        mData = static_cast<const std::byte *>(mapping);
+        mSize = std::size_t(status.st_size);
+        return true;
+#endif
+    }
+
+    void Close()
+    {
+#ifdef _WIN32
+        mContents.clear();
+#else
+        if (mData != nullptr)
+        {
+            ::munmap(const_cast<std::byte *>(mData), mSize);
+        }
+#endif
+        mData = nullptr;
+        mSize = 0;
+    }
+
+    const std::byte *Data() const
+    {
+        return mData;
+    }
+
+    std::size_t Size() const
+    {
+        return mSize;
+    }
+};
+
+/**
+ * @brief Writes a snapshot buffer to a file, to be opened later with MappedSnapshot.
+ */
+inline bool SaveSnapshotFile(const char *path, const std::vector<std::byte> &snapshot)
+{
+    std::FILE *file = std::fopen(path, "wb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    bool written = std::fwrite(snapshot.data(), 1, snapshot.size(), file) == snapshot.size();
+    return std::fclose(file) == 0 && written;
+}
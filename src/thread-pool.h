@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define THREAD_POOL_EXPORT __declspec(dllexport)
+#else
+#define THREAD_POOL_EXPORT
+#endif
+
+/**
+ * @brief Counts the tasks of a batch that have not finished yet, see ThreadPool::Wait.
+ */
+struct THREAD_POOL_EXPORT TaskGroup
+{
+    std::atomic<std::size_t> pending{0};
+};
+
+/**
+ * @brief Fixed set of worker threads with one task queue each and work stealing.
+ *
+ * A worker pushes and pops tasks at the back of its own queue, and when it runs dry it
+ * steals from the front of the other queues. Tasks submitted from outside the pool are
+ * spread over the queues round robin. Threads that wait on a TaskGroup run queued tasks
+ * while they wait, so tasks may submit and wait on nested work without deadlocking.
+ */
+class THREAD_POOL_EXPORT ThreadPool
+{
+private:
+    struct Task
+    {
+        std::function<void()> function;
+        TaskGroup *group = nullptr;
+    };
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> mWorkers{};
+    std::vector<std::thread> mThreads{};
+
+    // Queued tasks that no thread has picked up yet, sleeping workers wait for it to be non-zero
+    std::atomic<std::size_t> mQueued{0};
+    std::atomic<std::size_t> mNextQueue{0};
+    std::atomic<bool> mStopping{false};
+    std::mutex mSleepMutex;
+    std::condition_variable mWake;
+
+    // The pool and queue index of the current thread, when it is one of the workers
+    static inline thread_local ThreadPool *tPool = nullptr;
+    static inline thread_local std::size_t tIndex = 0;
+
+    bool IsWorkerThread() const
+    {
+        return tPool == this;
+    }
+
+    bool PopTask(std::size_t index, Task &task)
+    {
+        // Own queue first, newest task, it is the most likely to still be in cache
+        if (IsWorkerThread())
+        {
+            Worker &own = *mWorkers[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+
+        // Then steal the oldest task of the other queues
+        for (std::size_t offset = 1; offset <= mWorkers.size(); ++offset)
+        {
+            Worker &victim = *mWorkers[(index + offset) % mWorkers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void Execute(Task &task)
+    {
+        --mQueued;
+        task.function();
+
+        if (task.group != nullptr)
+        {
+            task.group->pending.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    void WorkerLoop(std::size_t index)
+    {
+        tPool = this;
+        tIndex = index;
+
+        while (!mStopping)
+        {
+            if (!RunPendingTask())
+            {
+                std::unique_lock<std::mutex> lock(mSleepMutex);
+                mWake.wait(lock, [this]
+                           { return mStopping || mQueued > 0; });
+            }
+        }
+    }
+
+public:
+    /**
+     * @param threadCount Number of worker threads, defaults to one less than the hardware
+     * threads because the thread that waits on the work also runs tasks.
+     */
+    explicit ThreadPool(std::size_t threadCount = std::max(1u, std::thread::hardware_concurrency()) - 1)
+    {
+        threadCount = std::max<std::size_t>(threadCount, 1);
+
+        for (std::size_t i = 0; i < threadCount; ++i)
+        {
+            mWorkers.push_back(std::make_unique<Worker>());
+        }
+
+        for (std::size_t i = 0; i < threadCount; ++i)
+        {
+            mThreads.emplace_back([this, i]
+                                  { WorkerLoop(i); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+            mStopping = true;
+        }
+        mWake.notify_all();
+
+        for (auto &thread : mThreads)
+        {
+            thread.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    std::size_t ThreadCount() const
+    {
+        return mThreads.size();
+    }
+
+    /**
+     * @brief Queues a task, the group (if any) counts it as pending until it has run.
+     */
+    void Submit(std::function<void()> function, TaskGroup *group = nullptr)
+    {
+        if (group != nullptr)
+        {
+            group->pending.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::size_t index = IsWorkerThread() ? tIndex : mNextQueue++ % mWorkers.size();
+        {
+            Worker &worker = *mWorkers[index];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks.push_back(Task{std::move(function), group});
+        }
+        ++mQueued;
+
+        // Taking the lock orders the notify after a worker that is about to sleep has checked mQueued
+        {
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+        }
+        mWake.notify_one();
+    }
+
+    /**
+     * @brief Runs one queued task on the calling thread.
+     *
+     * @return false if there was nothing to run.
+     */
+    bool RunPendingTask()
+    {
+        Task task;
+        if (!PopTask(IsWorkerThread() ? tIndex : 0, task))
+        {
+            return false;
+        }
+
+        Execute(task);
+        return true;
+    }
+
+    /**
+     * @brief Blocks until every task of the group has run, running queued tasks meanwhile.
+     */
+    void Wait(TaskGroup &group)
+    {
+        while (group.pending.load(std::memory_order_acquire) > 0)
+        {
+            if (!RunPendingTask())
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
+/**
+ * @brief Splits [0, count) into chunks and calls fn(begin, end) for each chunk on the pool.
+ *
+ * Blocks until every chunk has run, the calling thread runs chunks as well.
+ *
+ * @param grainSize Indices per chunk, 0 picks a size that gives every thread a few chunks
+ * so idle threads have something to steal.
+ */
+template <typename Fn>
+void ParallelFor(ThreadPool &pool, std::size_t count, Fn &&fn, std::size_t grainSize = 0)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    if (grainSize == 0)
+    {
+        std::size_t chunks = (pool.ThreadCount() + 1) * 4;
+        grainSize = std::max<std::size_t>(64, (count + chunks - 1) / chunks);
+    }
+
+    // A single chunk is not worth a trip through the queues
+    if (count <= grainSize)
+    {
+        fn(std::size_t{0}, count);
+        return;
+    }
+
+    TaskGroup group;
+    for (std::size_t begin = grainSize; begin < count; begin += grainSize)
+    {
+        std::size_t end = std::min(begin + grainSize, count);
+        pool.Submit([&fn, begin, end]
+                    { fn(begin, end); },
+                    &group);
+    }
+
+    fn(std::size_t{0}, grainSize);
+    pool.Wait(group);
+}